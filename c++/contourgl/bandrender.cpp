@@ -0,0 +1,93 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+
+#include <algorithm>
+
+#include "bandrender.h"
+
+
+using namespace std;
+
+
+BandRender::BandRender(int band_height, int max_marks):
+	band_height(band_height), max_marks(max_marks), surface()
+{
+	assert(band_height > 0);
+	assert(max_marks > 0);
+	// enough for band of common surface without reallocation
+	polyspan.set_reserve_step(min(band_height*1024, max_marks));
+	polyspan.set_max_covers(max_marks);
+}
+
+void BandRender::send_surface(Surface *surface)
+	{ this->surface = surface; }
+
+Surface* BandRender::receive_surface()
+	{ return surface; }
+
+void BandRender::send_paths(const Path *paths, int count) {
+	this->paths.assign(paths, paths + count);
+	bounds.resize(count);
+	for(int i = 0; i < count; ++i)
+		bounds[i] = paths[i].contour->get_bounds();
+}
+
+void BandRender::draw() {
+	assert(surface);
+	for(int y = 0; y < surface->height; y += band_height) {
+		int maxy = min(y + band_height, surface->height);
+		for(int i = 0; i < (int)paths.size(); ++i) {
+			const Path &path = paths[i];
+			// contours outside of band are skipped, inverted ones fill whole band
+			if ( !path.invert
+			  && (bounds[i].p1.y < (Real)y || bounds[i].p0.y > (Real)maxy) ) continue;
+
+			draw_path(path, y, maxy);
+		}
+	}
+}
+
+void BandRender::draw_path(const Path &path, int miny, int maxy) {
+	polyspan.init(0, miny, surface->width, maxy);
+	path.contour->to_polyspan(polyspan);
+	polyspan.sort_marks();
+
+	if (!polyspan.overflowed()) {
+		SwRender::polyspan(*surface, polyspan, path.color, path.evenodd, path.invert);
+		return;
+	}
+
+	if (maxy - miny > 1) {
+		// rows are independent, so halves of band may be drawn one by one
+		int y = (miny + maxy)/2;
+		draw_path(path, miny, y);
+		draw_path(path, y, maxy);
+		return;
+	}
+
+	// single row can't be split, so it is allowed to exceed the limit once
+	polyspan.set_max_covers(0);
+	polyspan.init(0, miny, surface->width, maxy);
+	path.contour->to_polyspan(polyspan);
+	polyspan.sort_marks();
+	SwRender::polyspan(*surface, polyspan, path.color, path.evenodd, path.invert);
+	polyspan.clear();
+	polyspan.shrink();
+	polyspan.set_max_covers(max_marks);
+}
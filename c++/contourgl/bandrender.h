@@ -0,0 +1,60 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _BANDRENDER_H_
+#define _BANDRENDER_H_
+
+#include <vector>
+
+#include "contour.h"
+#include "polyspan.h"
+#include "swrender.h"
+
+
+// Draws surface by horizontal bands: every contour is rasterized only inside of current band
+// and composited before next band is started. Only one polyspan is kept and its marks
+// are limited by max_marks: contour which doesn't fit is rasterized by halves of band,
+// so the limit may be exceeded only by contour with too many marks in a single row.
+class BandRender {
+public:
+	typedef ContourPath Path;
+
+private:
+	int band_height;
+	int max_marks;
+	Surface *surface;
+	std::vector<Path> paths;
+	std::vector<Rect> bounds;
+	Polyspan polyspan;
+
+	void draw_path(const Path &path, int miny, int maxy);
+
+public:
+	explicit BandRender(int band_height = 64, int max_marks = 256*1024);
+
+	void send_surface(Surface *surface);
+	Surface* receive_surface();
+	void send_paths(const Path *paths, int count);
+	void draw();
+
+	int get_band_height() const { return band_height; }
+	int get_max_marks() const { return max_marks; }
+	// count of marks reserved by polyspan, the peak of memory used for rasterization
+	size_t get_reserved_marks() const { return polyspan.get_covers().capacity(); }
+};
+
+#endif
@@ -0,0 +1,147 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+
+#include <algorithm>
+
+#include "batchrender.h"
+
+
+using namespace std;
+
+
+BatchRender::BatchRender(int max_size, int max_marks):
+	max_size(max_size), max_marks(max_marks), surface(), batches()
+{
+	// marks of small contours only, reserved memory grows geometrically
+	polyspan.set_reserve_step(4096);
+}
+
+void BatchRender::send_surface(Surface *surface)
+	{ this->surface = surface; }
+
+Surface* BatchRender::receive_surface()
+	{ return surface; }
+
+void BatchRender::send_paths(const Path *paths, int count) {
+	this->paths.assign(paths, paths + count);
+}
+
+void BatchRender::composite() {
+	if (entries.empty()) return;
+	++batches;
+
+	// tag marks by paths and sort them by rows, counting sort is stable,
+	// so marks of every row are grouped by paths in order of paths
+	// only rows of marks are counted, batch of small contours usually covers few rows
+	const Polyspan::cover_array &covers = polyspan.get_covers();
+	int miny = surface->height, maxy = 0;
+	for(Polyspan::cover_array::const_iterator i = covers.begin(); i != covers.end(); ++i)
+		{ miny = min(miny, i->y); maxy = max(maxy, i->y); }
+	assert(miny >= 0 && maxy <= surface->height);
+	offsets.assign(maxy - miny + 2, 0);
+	for(Polyspan::cover_array::const_iterator i = covers.begin(); i != covers.end(); ++i)
+		++offsets[i->y - miny + 1];
+	for(int y = 1; y < (int)offsets.size(); ++y)
+		offsets[y] += offsets[y - 1];
+	sorted.resize(covers.size());
+	int begin = 0;
+	for(vector<Entry>::const_iterator i = entries.begin(); i != entries.end(); ++i) {
+		for(int j = begin; j < i->end; ++j)
+			sorted[offsets[covers[j].y - miny]++] = Mark(covers[j], i->path);
+		begin = i->end;
+	}
+
+	// every row is drawn path by path, so overlapped pixels are blended in order of paths
+	vector<Mark>::iterator i = sorted.begin();
+	while(i != sorted.end()) {
+		const int y = i->y;
+		const int index = i->path;
+		const Path &path = paths[index];
+		SwRender::Blend blend(*surface, path.color);
+
+		// marks of path in row are in order of rasterization, sort them by x
+		vector<Mark>::iterator end = i;
+		while(++end != sorted.end() && end->y == y && end->path == index) { }
+		sort(i, end);
+
+		Real cover = 0;
+		while(true) {
+			int x = i->x;
+			Real area = i->area;
+			cover += i->cover;
+
+			// accumulate for the current pixel
+			while(++i != end && i->x == x) {
+				area += i->area;
+				cover += i->cover;
+			}
+
+			// draw pixel - based on covered area, like SwRender::walk
+			if (area) {
+				Real alpha = Polyspan::extract_alpha(cover - area, path.evenodd);
+				if (alpha) blend(x, y, 1, alpha);
+				++x;
+			}
+
+			// next path or next row
+			if (i == end)
+				break;
+
+			// draw span to next pixel - based on total amount of pixel cover
+			if (x < i->x) {
+				Real alpha = Polyspan::extract_alpha(cover, path.evenodd);
+				if (alpha) blend(x, y, i->x - x, alpha);
+			}
+		}
+	}
+
+	entries.clear();
+	polyspan.init(0, 0, surface->width, surface->height);
+}
+
+void BatchRender::draw() {
+	assert(surface);
+	batches = 0;
+	entries.clear();
+	polyspan.init(0, 0, surface->width, surface->height);
+	for(int i = 0; i < (int)paths.size(); ++i) {
+		const Path &path = paths[i];
+		Rect bounds = path.contour->get_bounds();
+		bool large = bounds.p1.x - bounds.p0.x > max_size
+		          || bounds.p1.y - bounds.p0.y > max_size;
+
+		if (path.invert || large) {
+			// previous paths should be drawn first
+			composite();
+			large_polyspan.init(0, 0, surface->width, surface->height);
+			path.contour->to_polyspan(large_polyspan);
+			large_polyspan.sort_marks();
+			SwRender::polyspan(*surface, large_polyspan, path.color, path.evenodd, path.invert);
+		} else {
+			// marks are appended to marks of previous paths of batch
+			path.contour->to_polyspan(polyspan);
+			polyspan.finish();
+			int end = (int)polyspan.get_covers().size();
+			if (end > (entries.empty() ? 0 : entries.back().end))
+				entries.push_back(Entry(i, end));
+			if (end >= max_marks) composite();
+		}
+	}
+	composite();
+}
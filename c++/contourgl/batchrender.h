@@ -0,0 +1,84 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _BATCHRENDER_H_
+#define _BATCHRENDER_H_
+
+#include <vector>
+
+#include "contour.h"
+#include "polyspan.h"
+#include "swrender.h"
+
+
+// Draws many small contours at once: contours are rasterized one by one into a single polyspan
+// without sorting, marks are tagged by index of path, sorted once by (y, path, x) and composited
+// in a single sweep by rows, so pixels where contours overlap are blended in order of paths.
+// Inverted and large contours break the batch and are drawn by SwRender::polyspan.
+class BatchRender {
+public:
+	typedef ContourPath Path;
+
+private:
+	struct Mark {
+		int y, x, path;
+		Real cover, area;
+		Mark(): y(), x(), path(), cover(), area() { }
+		Mark(const Polyspan::PenMark &mark, int path):
+			y(mark.y), x(mark.x), path(path), cover(mark.cover), area(mark.area) { }
+		bool operator< (const Mark &other) const {
+			return y != other.y ? y < other.y
+			     : path != other.path ? path < other.path
+			     : x < other.x;
+		}
+	};
+
+	// path of batch and end of its marks in covers of polyspan
+	struct Entry {
+		int path, end;
+		Entry(): path(), end() { }
+		Entry(int path, int end): path(path), end(end) { }
+	};
+
+	int max_size;
+	int max_marks;
+	Surface *surface;
+	std::vector<Path> paths;
+	Polyspan polyspan;
+	Polyspan large_polyspan;
+	std::vector<Entry> entries;
+	std::vector<Mark> sorted;
+	std::vector<int> offsets;
+	int batches;
+
+	void composite();
+
+public:
+	// contours with bounds larger than max_size pixels are drawn separately,
+	// batch is composited when count of its marks reaches max_marks
+	explicit BatchRender(int max_size = 64, int max_marks = 64*1024);
+
+	void send_surface(Surface *surface);
+	Surface* receive_surface();
+	void send_paths(const Path *paths, int count);
+	void draw();
+
+	// count of composited batches during the last draw
+	int get_batches() const { return batches; }
+};
+
+#endif
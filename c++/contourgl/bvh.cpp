@@ -0,0 +1,116 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <algorithm>
+
+#include "bvh.h"
+
+
+using namespace std;
+
+
+namespace {
+	class CenterLess {
+	private:
+		const vector<Vector> &centers;
+		int axis;
+	public:
+		CenterLess(const vector<Vector> &centers, int axis): centers(centers), axis(axis) { }
+		bool operator() (int a, int b) const
+			{ return centers[a][axis] < centers[b][axis]; }
+	};
+}
+
+
+void Bvh::clear() {
+	nodes.clear();
+	items.clear();
+	rects.clear();
+}
+
+int Bvh::build_node(int begin, int end, const vector<Vector> &centers) {
+	int index = (int)nodes.size();
+	nodes.push_back(Node());
+
+	Rect bounds = rects[items[begin]];
+	for(int i = begin + 1; i < end; ++i)
+		bounds = bounds.expand(rects[items[i]].p0).expand(rects[items[i]].p1);
+
+	if (end - begin <= max_leaf_items) {
+		Node &node = nodes[index];
+		node.bounds = bounds;
+		node.first = begin;
+		node.second = end;
+		node.leaf = true;
+		return index;
+	}
+
+	int axis = bounds.p1.x - bounds.p0.x < bounds.p1.y - bounds.p0.y ? 1 : 0;
+	int middle = (begin + end)/2;
+	nth_element(items.begin() + begin, items.begin() + middle, items.begin() + end, CenterLess(centers, axis));
+
+	// nodes may be reallocated while children are built
+	int first = build_node(begin, middle, centers);
+	int second = build_node(middle, end, centers);
+	Node &node = nodes[index];
+	node.bounds = bounds;
+	node.first = first;
+	node.second = second;
+	node.leaf = false;
+	return index;
+}
+
+void Bvh::build(const vector<Rect> &rects) {
+	clear();
+	if (rects.empty()) return;
+
+	this->rects = rects;
+	vector<Vector> centers(rects.size());
+	items.resize(rects.size());
+	for(int i = 0; i < (int)rects.size(); ++i) {
+		centers[i] = (rects[i].p0 + rects[i].p1)*0.5;
+		items[i] = i;
+	}
+
+	nodes.reserve(2*rects.size()/max_leaf_items + 1);
+	build_node(0, (int)items.size(), centers);
+}
+
+void Bvh::query(const Rect &rect, vector<int> &out_items) const {
+	out_items.clear();
+	if (nodes.empty()) return;
+
+	stack.clear();
+	stack.push_back(0);
+	while(!stack.empty()) {
+		const Node &node = nodes[stack.back()];
+		stack.pop_back();
+		if (!node.bounds.intersects(rect)) continue;
+		if (node.leaf) {
+			for(int i = node.first; i < node.second; ++i)
+				if (rects[items[i]].intersects(rect))
+					out_items.push_back(items[i]);
+		} else {
+			stack.push_back(node.second);
+			stack.push_back(node.first);
+		}
+	}
+
+	// order of drawing
+	sort(out_items.begin(), out_items.end());
+}
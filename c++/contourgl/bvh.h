@@ -0,0 +1,64 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _BVH_H_
+#define _BVH_H_
+
+#include <vector>
+
+#include "geometry.h"
+
+
+// Bounding volume hierarchy over rectangles (bounds of contours of scene)
+// for viewport queries and hit-testing. Tree is built top-down, items of node
+// are split by median of their centers along the longer side of node bounds.
+class Bvh {
+public:
+	struct Node {
+		Rect bounds;
+		// children of inner node or range of items of leaf
+		int first, second;
+		bool leaf;
+	};
+
+	static const int max_leaf_items = 4;
+
+private:
+	std::vector<Node> nodes;
+	std::vector<int> items;
+	std::vector<Rect> rects;
+	mutable std::vector<int> stack;
+
+	int build_node(int begin, int end, const std::vector<Vector> &centers);
+
+public:
+	void clear();
+	void build(const std::vector<Rect> &rects);
+
+	// indices of rectangles which intersect given one, in increasing order
+	void query(const Rect &rect, std::vector<int> &out_items) const;
+	// indices of rectangles which contain point, in increasing order
+	void query(const Vector &point, std::vector<int> &out_items) const
+		{ query(Rect(point, point), out_items); }
+
+	int get_nodes_count() const { return (int)nodes.size(); }
+	int get_items_count() const { return (int)items.size(); }
+	const std::vector<Node>& get_nodes() const { return nodes; }
+};
+
+#endif
@@ -30,12 +30,15 @@ kernel void path(
 	global long *marks,
 	global float2 *points,
 	int end,
-	int minx )
+	int minx,
+	float2 axis_x,
+	float2 axis_y,
+	float2 offset )
 {
 	int id = get_global_id(0);
 	if (id >= end) return;
-	float2 p0 = points[id];
-	float2 p1 = points[id + 1];
+	float2 p0 = axis_x*points[id].x + axis_y*points[id].y + offset;
+	float2 p1 = axis_x*points[id + 1].x + axis_y*points[id + 1].y + offset;
 	
 	bool flipx = p1.x < p0.x;
 	bool flipy = p1.y < p0.y;
@@ -55,6 +58,7 @@ kernel void path(
 		float2 px, py;
 		px.x = (float)(ix + 1);
 		py.y = (float)(iy + 1);
+		bool below = flipy ? iy < 0 : iy > h1;
 		iy = clamp(iy, 0, h1);
 		
 		px.y = p0.y + ky*(px.x - p0.x);
@@ -70,7 +74,9 @@ kernel void path(
 		if (flipy) { iy = h1 - iy; area = 1.f - area; }
 		p0 = pp1;
 		
-		atomic_add(marks + iy*width + ix, upsample((int)cover, (int)(area*cover)));
+		// rows below the frame doesn't affect it, but rows above does
+		if (!below)
+			atomic_add(marks + iy*width + ix, upsample((int)cover, (int)(area*cover)));
 	}
 }
 
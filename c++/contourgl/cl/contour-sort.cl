@@ -49,14 +49,17 @@ typedef struct {
 } Sample __attribute__((aligned (32))); 
 
 
-kernel void reset(global Sample *samples)
+kernel void reset(
+	int height,
+	global Sample *samples )
 {
 	int id = get_global_id(0);
+	if (id >= height) return;
 	samples[1+id].path_index = -1;
 	samples[1+id].next_index = 0;
 	if (id == 0) {
 		samples->path_index = -1;
-		samples->next_index = get_global_size(0) + 1;
+		samples->next_index = height + 1;
 	}
 }
 
@@ -65,12 +68,16 @@ kernel void paths(
 	int width,
 	int height,
 	global Sample *samples,
-	global const Point *points )
+	global const Point *points,
+	int count )
 {
 	const float e = 1e-6f;
 	
+	// global size may be rounded up to the group size
+	if ((int)get_global_id(0) >= count) return;
+	
 	// flip order, because we will insert samples into front of linked list 
-	int id = get_global_size(0) - get_global_id(0) - 1;
+	int id = count - get_global_id(0) - 1;
 	
 	float2 size = (float2)((float)width, (float)height); 
 	int w1 = width - 1;
@@ -130,11 +137,13 @@ kernel void paths(
 
 kernel void draw(
 	const int width,
+	const int height,
 	global float4 *image,
 	global Sample *samples,
 	global Path *paths )
 {
 	int id = get_global_id(0);
+	if (id >= height) return;
 
 	global float4 *image_row = image + id*width;
 	global Sample *first = &samples[1+id];
@@ -16,6 +16,7 @@
 */
 
 #include <cassert>
+#include <cctype>
 
 #include <iostream>
 #include <fstream>
@@ -26,6 +27,33 @@
 using namespace std;
 
 
+void ClProfile::load(const std::string &filename) {
+	this->filename = filename;
+	values.clear();
+
+	ifstream f(filename.c_str());
+	while(f) {
+		string name;
+		size_t value = 0;
+		if (f >> name >> value)
+			values[name] = value;
+	}
+}
+
+void ClProfile::save() const {
+	ofstream f(filename.c_str(), ofstream::out | ofstream::trunc);
+	for(map<string, size_t>::const_iterator i = values.begin(); i != values.end(); ++i)
+		f << i->first << " " << i->second << endl;
+	if (!f)
+		cout << "cannot save CL profile " << filename << endl;
+}
+
+size_t ClProfile::get(const std::string &name, size_t def) const {
+	map<string, size_t>::const_iterator i = values.find(name);
+	return i == values.end() ? def : i->second;
+}
+
+
 ClContext::ClContext():
 	err(),
 	device(),
@@ -84,6 +112,16 @@ ClContext::ClContext():
     assert(!err);
     //cout << "Device " << device_index << " OpenCL version " << device_version << endl;
 
+    char driver_version[256];
+    err |= clGetDeviceInfo(device, CL_DRIVER_VERSION, sizeof(driver_version), driver_version, NULL);
+    assert(!err);
+    //cout << "Device " << device_index << " driver version " << driver_version << endl;
+
+    // profile key, one profile per vendor, device and driver
+    device_key = string(vendor) + "-" + device_name + "-" + driver_version;
+    for(string::iterator i = device_key.begin(); i != device_key.end(); ++i)
+    	if (!isalnum(*i) && *i != '.' && *i != '-') *i = '_';
+
     err |= clGetDeviceInfo(device, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(max_compute_units), &max_compute_units, NULL);
     assert(!err);
     //cout << "Device " << device_index << " max compute units " << max_compute_units << endl;
@@ -138,6 +176,9 @@ ClContext::ClContext():
 		context, device, props, NULL);
 	assert(queue);
 
+	// tuned parameters
+	profile.load("profiles/" + device_key + ".txt");
+
 	//hello();
 }
 
@@ -171,6 +212,24 @@ cl_program ClContext::load_program(const std::string &filename) {
 	return program;
 }
 
+vector<size_t> ClContext::get_group_sizes(cl_kernel kernel) {
+	size_t kernel_group_size = 0;
+	err |= clGetKernelWorkGroupInfo(
+		kernel,
+		device,
+		CL_KERNEL_WORK_GROUP_SIZE,
+		sizeof(kernel_group_size),
+		&kernel_group_size,
+		NULL );
+	assert(!err);
+
+	// powers of two up to the limit of kernel
+	vector<size_t> sizes;
+	for(size_t size = 1; size <= kernel_group_size && size <= max_group_size; size *= 2)
+		sizes.push_back(size);
+	return sizes;
+}
+
 void ClContext::hello() {
 
 	// data
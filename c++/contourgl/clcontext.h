@@ -20,10 +20,27 @@
 
 #include <vector>
 #include <string>
+#include <map>
 
 #include <CL/opencl.h>
 
 
+class ClProfile {
+private:
+	std::string filename;
+	std::map<std::string, size_t> values;
+
+public:
+	void load(const std::string &filename);
+	void save() const;
+
+	const std::string& get_filename() const { return filename; }
+	size_t get(const std::string &name, size_t def) const;
+	void set(const std::string &name, size_t value)
+		{ values[name] = value; }
+};
+
+
 class ClContext {
 public:
 	cl_int err;
@@ -34,11 +51,15 @@ public:
 	unsigned int max_compute_units;
 	size_t max_group_size;
 
+	std::string device_key;
+	ClProfile profile;
+
 	ClContext();
 	~ClContext();
 
 	void hello();
 	cl_program load_program(const std::string &filename);
+	std::vector<size_t> get_group_sizes(cl_kernel kernel);
 	static void callback(const char *, const void *, size_t, void *);
 };
 
@@ -27,6 +27,12 @@
 using namespace std;
 
 
+static size_t round_up(size_t count, size_t group_size)
+	{ return group_size ? ((count - 1)/group_size + 1)*group_size : count; }
+
+static const int tune_repeats = 10;
+
+
 ClRender::ClRender(ClContext &cl):
 	cl(cl),
 	contour_program(),
@@ -52,6 +58,8 @@ ClRender::ClRender(ClContext &cl):
 		&contour_draw_workgroup_size,
 		NULL );
 	assert(!cl.err);
+
+	contour_draw_workgroup_size = cl.profile.get("ClRender.draw", contour_draw_workgroup_size);
 }
 
 ClRender::~ClRender() {
@@ -188,6 +196,35 @@ void ClRender::wait() {
 	}
 }
 
+long long ClRender::measure() {
+	long long best = 0;
+	for(int i = 0; i < tune_repeats; ++i) {
+		long long t = Measure::get_time();
+		draw();
+		wait();
+		t = Measure::get_time() - t;
+		if (!i || t < best) best = t;
+	}
+	return best;
+}
+
+void ClRender::tune() {
+	assert(surface);
+	assert(paths_buffer);
+
+	vector<size_t> sizes = cl.get_group_sizes(contour_draw_kernel);
+	long long best_time = 0;
+	size_t best_size = contour_draw_workgroup_size;
+	for(vector<size_t>::const_iterator i = sizes.begin(); i != sizes.end(); ++i) {
+		contour_draw_workgroup_size = *i;
+		long long t = measure();
+		if (i == sizes.begin() || t < best_time)
+			{ best_time = t; best_size = *i; }
+	}
+	contour_draw_workgroup_size = best_size;
+	cl.profile.set("ClRender.draw", contour_draw_workgroup_size);
+}
+
 
 // ------------------------------------------------
 
@@ -198,6 +235,9 @@ ClRender2::ClRender2(ClContext &cl):
 	contour_reset_kernel(),
 	contour_paths_kernel(),
 	contour_draw_kernel(),
+	contour_reset_group_size(),
+	contour_paths_group_size(),
+	contour_draw_group_size(),
 	surface(),
 	points_count(),
 	paths_buffer(),
@@ -228,10 +268,15 @@ ClRender2::ClRender2(ClContext &cl):
 	assert(!cl.err);
 	assert(samples_buffer);
 
-	cl.err |= clSetKernelArg(contour_reset_kernel, 0, sizeof(samples_buffer), &samples_buffer);
+	cl.err |= clSetKernelArg(contour_reset_kernel, 1, sizeof(samples_buffer), &samples_buffer);
 	cl.err |= clSetKernelArg(contour_paths_kernel, 2, sizeof(samples_buffer), &samples_buffer);
-	cl.err |= clSetKernelArg(contour_draw_kernel, 2, sizeof(samples_buffer), &samples_buffer);
+	cl.err |= clSetKernelArg(contour_draw_kernel, 3, sizeof(samples_buffer), &samples_buffer);
 	assert(!cl.err);
+
+	// zero means that group size will be chosen by driver
+	contour_reset_group_size = cl.profile.get("ClRender2.reset", 0);
+	contour_paths_group_size = cl.profile.get("ClRender2.paths", 0);
+	contour_draw_group_size = cl.profile.get("ClRender2.draw", 0);
 }
 
 ClRender2::~ClRender2() {
@@ -281,10 +326,12 @@ void ClRender2::send_surface(Surface *surface) {
 		0, NULL, NULL );
 	assert(!cl.err);
 
+	cl.err |= clSetKernelArg(contour_reset_kernel, 0, sizeof(surface->height), &surface->height);
 	cl.err |= clSetKernelArg(contour_paths_kernel, 0, sizeof(surface->width), &surface->width);
 	cl.err |= clSetKernelArg(contour_paths_kernel, 1, sizeof(surface->height), &surface->height);
 	cl.err |= clSetKernelArg(contour_draw_kernel, 0, sizeof(surface->width), &surface->width);
-	cl.err |= clSetKernelArg(contour_draw_kernel, 1, sizeof(surface_image), &surface_image);
+	cl.err |= clSetKernelArg(contour_draw_kernel, 1, sizeof(surface->height), &surface->height);
+	cl.err |= clSetKernelArg(contour_draw_kernel, 2, sizeof(surface_image), &surface_image);
 	assert(!cl.err);
 }
 
@@ -358,8 +405,10 @@ void ClRender2::send_paths(const Path *paths, int paths_count, const Point *poin
 		0, NULL, NULL );
 	assert(!cl.err);
 
+	int segments_count = points_count - 1;
 	cl.err |= clSetKernelArg(contour_paths_kernel, 3, sizeof(points_buffer), &points_buffer);
-	cl.err |= clSetKernelArg(contour_draw_kernel, 3, sizeof(paths_buffer), &paths_buffer);
+	cl.err |= clSetKernelArg(contour_paths_kernel, 4, sizeof(segments_count), &segments_count);
+	cl.err |= clSetKernelArg(contour_draw_kernel, 4, sizeof(paths_buffer), &paths_buffer);
 	assert(!cl.err);
 
 	wait();
@@ -371,40 +420,40 @@ void ClRender2::draw() {
 	cl_event prepare_event;
 	cl_event paths_event;
 
-	size_t count = surface->height;
+	size_t count = round_up(surface->height, contour_reset_group_size);
 	cl.err |= clEnqueueNDRangeKernel(
 		cl.queue,
 		contour_reset_kernel,
 		1,
 		NULL,
 		&count,
-		NULL,
+		contour_reset_group_size ? &contour_reset_group_size : NULL,
 		prev_event ? 1 : 0,
 		prev_event ? &prev_event : NULL,
 		&prepare_event );
 	assert(!cl.err);
 
-	count = points_count - 1;
+	count = round_up(points_count - 1, contour_paths_group_size);
 	cl.err |= clEnqueueNDRangeKernel(
 		cl.queue,
 		contour_paths_kernel,
 		1,
 		NULL,
 		&count,
-		NULL,
+		contour_paths_group_size ? &contour_paths_group_size : NULL,
 		1,
 		&prepare_event,
 		&paths_event );
 	assert(!cl.err);
 
-	count = surface->height;
+	count = round_up(surface->height, contour_draw_group_size);
 	cl.err |= clEnqueueNDRangeKernel(
 		cl.queue,
 		contour_draw_kernel,
 		1,
 		NULL,
 		&count,
-		NULL,
+		contour_draw_group_size ? &contour_draw_group_size : NULL,
 		1,
 		&paths_event,
 		&prev_event );
@@ -417,6 +466,47 @@ void ClRender2::wait() {
 	prev_event = NULL;
 }
 
+long long ClRender2::measure() {
+	long long best = 0;
+	for(int i = 0; i < tune_repeats; ++i) {
+		long long t = Measure::get_time();
+		draw();
+		wait();
+		t = Measure::get_time() - t;
+		if (!i || t < best) best = t;
+	}
+	return best;
+}
+
+void ClRender2::tune_group_size(size_t &group_size, cl_kernel kernel) {
+	// try driver choice first
+	group_size = 0;
+	long long best_time = measure();
+	size_t best_size = 0;
+
+	vector<size_t> sizes = cl.get_group_sizes(kernel);
+	for(vector<size_t>::const_iterator i = sizes.begin(); i != sizes.end(); ++i) {
+		group_size = *i;
+		long long t = measure();
+		if (t < best_time)
+			{ best_time = t; best_size = *i; }
+	}
+	group_size = best_size;
+}
+
+void ClRender2::tune() {
+	assert(surface);
+	assert(paths_buffer);
+
+	tune_group_size(contour_reset_group_size, contour_reset_kernel);
+	tune_group_size(contour_paths_group_size, contour_paths_kernel);
+	tune_group_size(contour_draw_group_size, contour_draw_kernel);
+
+	cl.profile.set("ClRender2.reset", contour_reset_group_size);
+	cl.profile.set("ClRender2.paths", contour_paths_group_size);
+	cl.profile.set("ClRender2.draw", contour_draw_group_size);
+}
+
 
 // ------------------------------------------------
 
@@ -426,11 +516,14 @@ ClRender3::ClRender3(ClContext &cl):
 	contour_program(),
 	contour_path_kernel(),
 	contour_fill_kernel(),
+	contour_path_group_size(),
+	contour_fill_group_size(),
 	surface(),
 	points_buffer(),
 	mark_buffer(),
 	surface_image(),
-	prev_event()
+	prev_event(),
+	transform()
 {
 	contour_program = cl.load_program("contour-base.cl");
 	assert(contour_program);
@@ -442,6 +535,11 @@ ClRender3::ClRender3(ClContext &cl):
 	contour_fill_kernel = clCreateKernel(contour_program, "fill", &cl.err);
 	assert(!cl.err);
 	assert(contour_fill_kernel);
+
+	contour_path_group_size = cl.profile.get("ClRender3.path", 128);
+	contour_fill_group_size = cl.profile.get("ClRender3.fill", 16);
+
+	set_transform(affine2f());
 }
 
 ClRender3::~ClRender3() {
@@ -458,8 +556,10 @@ void ClRender3::send_surface(Surface *surface) {
 	if (this->surface) {
 		wait();
 		cl.err |= clReleaseMemObject(surface_image);
+		cl.err |= clReleaseMemObject(mark_buffer);
 		assert(!cl.err);
 		surface_image = NULL;
+		mark_buffer = NULL;
 	}
 
 	this->surface = surface;
@@ -556,17 +656,36 @@ void ClRender3::send_points(const vec2f *points, int count) {
 	}
 }
 
+void ClRender3::set_transform(const affine2f &transform) {
+	this->transform = transform;
+	cl.err |= clSetKernelArg(contour_path_kernel, 6, sizeof(transform.axis_x), &transform.axis_x);
+	cl.err |= clSetKernelArg(contour_path_kernel, 7, sizeof(transform.axis_y), &transform.axis_y);
+	cl.err |= clSetKernelArg(contour_path_kernel, 8, sizeof(transform.offset), &transform.offset);
+	assert(!cl.err);
+}
+
 void ClRender3::draw(const Path &path) {
 	//Measure t("ClRender::contour");
 
 	assert(surface);
 	assert(points_buffer);
 
+	ContextRect path_bounds = path.bounds;
+	if (!transform.is_identity()) {
+		rectf r = transform.transform_bounds(rectf(
+			(float)path.bounds.minx, (float)path.bounds.miny,
+			(float)path.bounds.maxx, (float)path.bounds.maxy ));
+		path_bounds.minx = (int)floor(r.p0.x);
+		path_bounds.miny = (int)floor(r.p0.y);
+		path_bounds.maxx = (int)ceil(r.p1.x);
+		path_bounds.maxy = (int)ceil(r.p1.y);
+	}
+
 	ContextRect bounds;
-	bounds.minx = max(1, path.bounds.minx);
-	bounds.maxx = min(surface->width, path.bounds.maxx);
-	bounds.miny = max(0, path.bounds.miny);
-	bounds.maxy = min(surface->height, path.bounds.maxy);
+	bounds.minx = max(1, path_bounds.minx);
+	bounds.maxx = min(surface->width, path_bounds.maxx);
+	bounds.miny = max(0, path_bounds.miny);
+	bounds.maxy = min(surface->height, path_bounds.maxy);
 	if ( bounds.minx >= bounds.maxx
 	  || bounds.miny >= bounds.maxy
 	  || path.begin >= path.end ) return;
@@ -585,9 +704,9 @@ void ClRender3::draw(const Path &path) {
 
 	offset = path.begin;
 	count = path.end - path.begin - 1;
-	group_size = 128;
+	group_size = contour_path_group_size;
 
-	count = ((count - 1)/group_size + 1)*group_size;
+	count = round_up(count, group_size);
 	cl.err |= clEnqueueNDRangeKernel(
 		cl.queue, contour_path_kernel,
 		1, &offset, &count, &group_size,
@@ -596,9 +715,9 @@ void ClRender3::draw(const Path &path) {
 
 	offset = bounds.minx;
 	count = bounds.maxx - bounds.minx;
-	group_size = 16;
+	group_size = contour_fill_group_size;
 
-	count = ((count - 1)/group_size + 1)*group_size;
+	count = round_up(count, group_size);
 	cl.err |= clEnqueueNDRangeKernel(
 		cl.queue, contour_fill_kernel,
 		1, &offset, &count, &group_size,
@@ -616,3 +735,40 @@ void ClRender3::wait() {
 	}
 }
 
+long long ClRender3::measure(const Path *paths, int count) {
+	long long best = 0;
+	for(int i = 0; i < tune_repeats; ++i) {
+		long long t = Measure::get_time();
+		for(const Path *p = paths, *end = paths + count; p < end; ++p)
+			draw(*p);
+		wait();
+		t = Measure::get_time() - t;
+		if (!i || t < best) best = t;
+	}
+	return best;
+}
+
+void ClRender3::tune_group_size(size_t &group_size, cl_kernel kernel, const Path *paths, int count) {
+	vector<size_t> sizes = cl.get_group_sizes(kernel);
+	long long best_time = 0;
+	size_t best_size = group_size;
+	for(vector<size_t>::const_iterator i = sizes.begin(); i != sizes.end(); ++i) {
+		group_size = *i;
+		long long t = measure(paths, count);
+		if (i == sizes.begin() || t < best_time)
+			{ best_time = t; best_size = *i; }
+	}
+	group_size = best_size;
+}
+
+void ClRender3::tune(const Path *paths, int count) {
+	assert(surface);
+	assert(points_buffer);
+	assert(paths);
+
+	tune_group_size(contour_path_group_size, contour_path_kernel, paths, count);
+	tune_group_size(contour_fill_group_size, contour_fill_kernel, paths, count);
+
+	cl.profile.set("ClRender3.path", contour_path_group_size);
+	cl.profile.set("ClRender3.fill", contour_fill_group_size);
+}
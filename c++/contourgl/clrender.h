@@ -39,6 +39,8 @@ private:
 	cl_mem surface_image;
 	cl_event prev_event;
 
+	long long measure();
+
 public:
 	ClRender(ClContext &cl);
 	~ClRender();
@@ -49,6 +51,9 @@ public:
 	void remove_paths();
 	void draw();
 	void wait();
+
+	// choose the fastest workgroup size for the sent surface and paths
+	void tune();
 };
 
 
@@ -74,6 +79,9 @@ private:
 	cl_kernel contour_reset_kernel;
 	cl_kernel contour_paths_kernel;
 	cl_kernel contour_draw_kernel;
+	size_t contour_reset_group_size;
+	size_t contour_paths_group_size;
+	size_t contour_draw_group_size;
 
 	Surface *surface;
 	int points_count;
@@ -83,6 +91,9 @@ private:
 	cl_mem surface_image;
 	cl_event prev_event;
 
+	long long measure();
+	void tune_group_size(size_t &group_size, cl_kernel kernel);
+
 public:
 	ClRender2(ClContext &cl);
 	~ClRender2();
@@ -96,6 +107,9 @@ public:
 
 	void draw();
 	void wait();
+
+	// choose the fastest workgroup sizes for the sent surface and paths
+	void tune();
 };
 
 
@@ -115,12 +129,18 @@ private:
 	cl_program contour_program;
 	cl_kernel contour_path_kernel;
 	cl_kernel contour_fill_kernel;
+	size_t contour_path_group_size;
+	size_t contour_fill_group_size;
 
 	Surface *surface;
 	cl_mem points_buffer;
 	cl_mem mark_buffer;
 	cl_mem surface_image;
 	cl_event prev_event;
+	affine2f transform;
+
+	long long measure(const Path *paths, int count);
+	void tune_group_size(size_t &group_size, cl_kernel kernel, const Path *paths, int count);
 
 public:
 	ClRender3(ClContext &cl);
@@ -131,8 +151,16 @@ public:
 
 	void send_points(const vec2f *points, int count);
 
+	// matrix applied to sent points by kernel for the following draw calls,
+	// so moving of static geometry costs no re-upload of points
+	void set_transform(const affine2f &transform);
+	const affine2f& get_transform() const { return transform; }
+
 	void draw(const Path &path);
 	void wait();
+
+	// choose the fastest workgroup sizes for the sent surface, points and given paths
+	void tune(const Path *paths, int count);
 };
 
 
@@ -18,66 +18,112 @@
 #include <cassert>
 
 #include "contour.h"
+#include "triangulator.h"
 
 
 using namespace std;
 
 
 const Vector Contour::blank;
+const Real Contour::lod_tolerance = 0.25;
 
 
-void Contour::clear() {
-	if (!chunks.empty()) {
-		chunks.clear();
-		first = 0;
+void Contour::reset_triangles() {
+	for(int i = 0; i < 2; ++i) {
+		if (triangles_cache[i].valid) {
+			triangles_cache[i].valid = false;
+			triangles_cache[i].success = false;
+			triangles_cache[i].triangles.clear();
+		}
+	}
+}
+
+void Contour::changed() {
+	// apply pending transformation and take own copy of shared geometry before editing
+	if (!matrix.is_identity()) {
+		geometry = std::make_shared<ChunkList>(get_chunks());
+		matrix = Affine();
+	} else
+	if (geometry.use_count() > 1) {
+		geometry = std::make_shared<ChunkList>(*geometry);
 	}
+	transformed.reset();
+	geometry_bounds_valid = false;
+	bounds_valid = false;
+	shape_valid = false;
+
+	reset_triangles();
+	if (!lod_levels.empty()) lod_levels.clear();
+	lod_scale = 1.0;
+}
+
+void Contour::clear() {
+	// no sense to apply pending transformation or to copy shared geometry
+	matrix = Affine();
+	if (geometry.use_count() > 1)
+		geometry = std::make_shared<ChunkList>();
+	else
+		geometry->clear();
+	first = 0;
+	changed();
 }
 
 void Contour::move_to(const Vector &v) {
-	if (chunks.empty()) {
+	changed();
+	if (geometry->empty()) {
 		if (!v.is_equal_to(blank))
-			chunks.push_back(Chunk(MOVE, v));
+			geometry->push_back(Chunk(MOVE, v));
 	} else {
-		if (!v.is_equal_to(chunks.back().p1)) {
-			if (chunks.back().type == MOVE)
-				chunks.back().p1 = v;
+		if (!v.is_equal_to(geometry->back().p1)) {
+			if (geometry->back().type == MOVE)
+				geometry->back().p1 = v;
 			else
-			if (chunks.back().type == CLOSE)
-				chunks.push_back(Chunk(MOVE, v));
+			if (geometry->back().type == CLOSE)
+				geometry->push_back(Chunk(MOVE, v));
 			else {
-				chunks.push_back(Chunk(CLOSE, chunks[first].p1));
-				chunks.push_back(Chunk(MOVE, v));
+				geometry->push_back(Chunk(CLOSE, (*geometry)[first].p1));
+				geometry->push_back(Chunk(MOVE, v));
 			}
 		}
 	}
-	first = chunks.size();
+	first = geometry->size();
 }
 
 void Contour::line_to(const Vector &v) {
+	changed();
 	if (!v.is_equal_to(current()))
-		chunks.push_back(Chunk(LINE, v));
+		geometry->push_back(Chunk(LINE, v));
 }
 
 void Contour::conic_to(const Vector &v, const Vector &t) {
+	changed();
 	if (!v.is_equal_to(current()))
-		chunks.push_back(Chunk(CONIC, v, t));
+		geometry->push_back(Chunk(CONIC, v, t));
 }
 
 void Contour::cubic_to(const Vector &v, const Vector &t0, const Vector &t1) {
+	changed();
 	if (!v.is_equal_to(current()))
-		chunks.push_back(Chunk(CUBIC, v, t0, t1));
+		geometry->push_back(Chunk(CUBIC, v, t0, t1));
 }
 
 void Contour::close() {
-	if (chunks.size() > first) {
+	changed();
+	if (geometry->size() > first) {
 		if (first > 0)
-			chunks.push_back(Chunk(CLOSE, chunks[first-1].p1));
+			geometry->push_back(Chunk(CLOSE, (*geometry)[first-1].p1));
 		else
-			chunks.push_back(Chunk(CLOSE, blank));
-		first = chunks.size();
+			geometry->push_back(Chunk(CLOSE, blank));
+		first = geometry->size();
 	}
 }
 
+void Contour::set_chunk(int index, const Chunk &chunk) {
+	changed();
+	assert(index >= 0 && index < (int)geometry->size());
+	(*geometry)[index] = chunk;
+}
+
 void Contour::line_split(
 	Rect &ref_line_bounds,
 	const Rect &bounds,
@@ -118,8 +164,8 @@ void Contour::line_split(
 		}
 	}
 
-	if (!chunks.empty())
-		chunks.back().p1 = p1;
+	if (!geometry->empty())
+		geometry->back().p1 = p1;
 }
 
 void Contour::conic_split(
@@ -131,21 +177,16 @@ void Contour::conic_split(
 	Real radius,
 	Real radians0,
 	Real radians1,
-	int level )
+	Real tolerance )
 {
-	assert(level > 0);
-
 	const Vector &p0 = current();
 	if ( fabs(p1.x - p0.x) > min_size.x
 	  || fabs(p1.y - p0.y) > min_size.y )
 	{
 		Rect b = conic_bounds(p0, p1, center, radius, radians0, radians1);
 		if (bounds.intersects(b)) {
-			Real radians = 0.5*(radians0 + radians1);
-			Vector p( radius*cos(radians) + center.x,
-					  radius*sin(radians) + center.y );
-			conic_split(ref_line_bounds, bounds, min_size,  p, center, radius, radians0, radians, level - 1);
-			conic_split(ref_line_bounds, bounds, min_size, p1, center, radius, radians, radians1, level - 1);
+			LineSplit target(*this, ref_line_bounds, bounds, min_size);
+			Flatten::arc(center, radius, radians0, radians1, p1, tolerance, target);
 			return;
 		}
 	}
@@ -159,38 +200,31 @@ void Contour::cubic_split(
 	const Vector &p1,
 	const Vector &bezier_pp0,
 	const Vector &bezier_pp1,
-	int level )
+	Real tolerance )
 {
-	assert(level > 0);
-
-	const Vector &p0 = current();
+	// copy, because current point will be changed while flattening
+	Vector p0 = current();
 	if ( fabs(p1.x - p0.x) > min_size.x
 	  || fabs(p1.y - p0.y) > min_size.y )
 	{
 		Rect b = cubic_bounds(p0, p1, bezier_pp0, bezier_pp1);
 		if (bounds.intersects(b)) {
-			Vector pp = (bezier_pp0 + bezier_pp1)*0.5;
-			Vector pp00 = (p0 + bezier_pp0)*0.5;
-			Vector pp11 = (p1 + bezier_pp1)*0.5;
-			Vector pp01 = (pp00 + pp)*0.5;
-			Vector pp10 = (pp11 + pp)*0.5;
-			Vector p = (pp01 + pp10)*0.5;
-
-			cubic_split(ref_line_bounds, bounds, min_size,  p, pp00, pp01, level - 1);
-			cubic_split(ref_line_bounds, bounds, min_size, p1, pp10, pp11, level - 1);
+			LineSplit target(*this, ref_line_bounds, bounds, min_size);
+			Flatten::cubic(p0, bezier_pp0, bezier_pp1, p1, tolerance, target);
 			return;
 		}
 	}
 	line_split(ref_line_bounds, bounds, min_size, p1);
 }
 
-void Contour::split(Contour &c, const Rect &bounds, const Vector &min_size) const {
+void Contour::split(Contour &c, const Rect &bounds, const Vector &min_size, Real tolerance) const {
 	c.clear();
 
 	Rect line_bounds;
 	line_bounds.p0 = c.current();
 	line_bounds.p1 = c.current();
 
+	const ChunkList &chunks = get_chunks();
 	for(ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
 		switch(i->type) {
 		case MOVE:
@@ -210,7 +244,7 @@ void Contour::split(Contour &c, const Rect &bounds, const Vector &min_size) cons
 				Real radians0 = 0.0;
 				Real radians1 = 0.0;
 				if (conic_convert(p0, i->p1, i->t0, center, radius, radians0, radians1))
-					c.conic_split(line_bounds, bounds, min_size, i->p1, center, radius, radians0, radians1);
+					c.conic_split(line_bounds, bounds, min_size, i->p1, center, radius, radians0, radians1, tolerance);
 				else
 					c.line_split(line_bounds, bounds, min_size, i->p1);
 			}
@@ -220,7 +254,7 @@ void Contour::split(Contour &c, const Rect &bounds, const Vector &min_size) cons
 				const Vector &p0 = c.current();
 				Vector pp0, pp1;
 				cubic_convert(p0, i->p1, i->t0, i->t1, pp0, pp1);
-				c.cubic_split(line_bounds, bounds, min_size, i->p1, pp0, pp1);
+				c.cubic_split(line_bounds, bounds, min_size, i->p1, pp0, pp1, tolerance);
 			}
 			break;
 		}
@@ -263,6 +297,46 @@ bool Contour::conic_convert(
 	return true;
 }
 
+Contour::ShapeType Contour::classify(const std::vector<Vector> &points) {
+	int count = (int)points.size();
+	if (count < 3)
+		return GENERAL;
+
+	// all turns are in the same direction and polygon goes round only once,
+	// so every coordinate changes direction of movement only twice
+	int turn = 0;
+	int changes_x = 0, changes_y = 0;
+	Real prev_x = 0, prev_y = 0;
+	for(int i = 0; i < 2*count; ++i) {
+		Vector e0 = points[(i + 1)%count] - points[i%count];
+		Vector e1 = points[(i + 2)%count] - points[(i + 1)%count];
+		Real cross = e0.x*e1.y - e0.y*e1.x;
+		int t = cross > 0 ? 1 : cross < 0 ? -1 : 0;
+		if (t && turn && t != turn) return GENERAL;
+		if (t) turn = t;
+
+		// second round counts changes of the closed polygon
+		if (e0.x) { if (i >= count && e0.x*prev_x < 0) ++changes_x; prev_x = e0.x; }
+		if (e0.y) { if (i >= count && e0.y*prev_y < 0) ++changes_y; prev_y = e0.y; }
+	}
+	if (!turn || changes_x > 2 || changes_y > 2)
+		return GENERAL;
+
+	// edges of rectangle are horizontal and vertical one by one
+	if (count == 4) {
+		bool rectangle = true;
+		for(int i = 0; i < count; ++i) {
+			Vector e0 = points[(i + 1)%count] - points[i];
+			Vector e1 = points[(i + 2)%count] - points[(i + 1)%count];
+			if (!( (e0.x == 0 && e1.y == 0) || (e0.y == 0 && e1.x == 0) ))
+				rectangle = false;
+		}
+		if (rectangle)
+			return RECTANGLE;
+	}
+	return CONVEX;
+}
+
 Rect Contour::conic_bounds(
 	const Vector &p0,
 	const Vector &p1,
@@ -316,83 +390,317 @@ Rect Contour::cubic_bounds(
 }
 
 void Contour::transform(const Rect &from, const Rect &to) {
-	Vector s( (to.p1.x - to.p0.x)/(from.p1.x - from.p0.x),
-			  (to.p1.y - to.p0.y)/(from.p1.y - from.p0.y) );
-	Vector o( to.p0.x - from.p0.x*s.x,
-			  to.p0.y - from.p0.y*s.y );
-	for(Contour::ChunkList::iterator i = chunks.begin(); i != chunks.end(); ++i) {
-		i->p1 = i->p1*s + o;
-		i->t0 = i->t0*s;
-		i->t1 = i->t1*s;
+	transform(Affine::rect_to_rect(from, to));
+}
+
+void Contour::transform(const Affine &matrix) {
+	// geometry is not changed, matrix is applied later
+	reset_triangles();
+	this->matrix = matrix*this->matrix;
+	transformed.reset();
+	bounds_valid = false;
+
+	// levels of detail stay valid, only their tolerances are scaled
+	for(vector<Contour>::iterator i = lod_levels.begin(); i != lod_levels.end(); ++i)
+		i->transform(matrix);
+	lod_scale *= sqrt(fabs(matrix.axis_x.x*matrix.axis_y.y - matrix.axis_x.y*matrix.axis_y.x));
+}
+
+Rect Contour::chunks_bounds(const ChunkList &chunks) {
+	if (chunks.empty())
+		return Rect();
+
+	Vector p0 = blank;
+	Rect r(chunks.front().p1, chunks.front().p1);
+	for(ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+		r = r.expand(i->p1);
+		if (i->type == CONIC) {
+			Vector center;
+			Real radius = 0.0;
+			Real radians0 = 0.0;
+			Real radians1 = 0.0;
+			if (conic_convert(p0, i->p1, i->t0, center, radius, radians0, radians1)) {
+				Rect b = conic_bounds(p0, i->p1, center, radius, radians0, radians1);
+				r = r.expand(b.p0).expand(b.p1);
+			}
+		} else
+		if (i->type == CUBIC) {
+			Vector pp0, pp1;
+			cubic_convert(p0, i->p1, i->t0, i->t1, pp0, pp1);
+			r = r.expand(pp0).expand(pp1);
+		}
+		p0 = i->p1;
+	}
+
+	// polyspan starts from not transformed blank point if there is no move at start
+	if (chunks.front().type != MOVE)
+		r = r.expand(blank);
+	return r;
+}
+
+Rect Contour::get_bounds() const {
+	if (bounds_valid)
+		return bounds;
+
+	if (matrix.is_conformal()) {
+		if (!geometry_bounds_valid) {
+			geometry_bounds = chunks_bounds(*geometry);
+			geometry_bounds_valid = true;
+		}
+		bounds = matrix.is_identity() ? geometry_bounds : matrix.transform_bounds(geometry_bounds);
+		if (!geometry->empty() && geometry->front().type != MOVE)
+			bounds = bounds.expand(blank);
+	} else {
+		// arc is not transformed to arc by other transformations, so chunks are transformed first
+		bounds = chunks_bounds(get_chunks());
+	}
+	bounds_valid = true;
+	return bounds;
+}
+
+Contour::ShapeType Contour::get_shape() const {
+	if (shape_valid)
+		return shape;
+	shape_valid = true;
+	shape = GENERAL;
+	shape_points.clear();
+
+	// single polygon which starts by move and is closed
+	const ChunkList &chunks = *geometry;
+	if (chunks.empty() || chunks.front().type != MOVE)
+		return shape;
+	shape_points.push_back(chunks.front().p1);
+	for(ChunkList::const_iterator i = chunks.begin() + 1; i != chunks.end(); ++i) {
+		if (i->type == CLOSE && i + 1 == chunks.end())
+			break;
+		if (i->type != LINE)
+			{ shape_points.clear(); return shape; }
+		if (!i->p1.is_equal_to(shape_points.back()))
+			shape_points.push_back(i->p1);
 	}
+	if (shape_points.back().is_equal_to(shape_points.front()))
+		shape_points.pop_back();
+	else
+	if (chunks.back().type != CLOSE)
+		{ shape_points.clear(); return shape; }
+
+	shape = classify(shape_points);
+	if (shape == GENERAL)
+		shape_points.clear();
+	return shape;
 }
 
-void Contour::downgrade(Contour &c, const Vector &min_size) const {
+const Contour::ChunkList& Contour::get_chunks() const {
+	if (matrix.is_identity())
+		return *geometry;
+	if (!transformed) {
+		std::shared_ptr<ChunkList> chunks = std::make_shared<ChunkList>(*geometry);
+		for(ChunkList::iterator i = chunks->begin(); i != chunks->end(); ++i) {
+			i->p1 = matrix.transform(i->p1);
+			i->t0 = matrix.transform_vector(i->t0);
+			i->t1 = matrix.transform_vector(i->t1);
+		}
+		transformed = chunks;
+	}
+	return *transformed;
+}
+void Contour::simplify(const std::vector<Vector> &points, Real tolerance, std::vector<bool> &out_keep) {
+	out_keep.clear();
+	out_keep.resize(points.size(), false);
+	if (points.empty()) return;
+	out_keep.front() = true;
+	out_keep.back() = true;
+
+	// Douglas-Peucker with explicit stack of ranges,
+	// distance is measured to segment (not to line), so closed rings are also supported
+	Real tolerance2 = tolerance*tolerance;
+	std::vector< std::pair<int, int> > stack;
+	stack.push_back(std::make_pair(0, (int)points.size() - 1));
+	while(!stack.empty()) {
+		int a = stack.back().first;
+		int b = stack.back().second;
+		stack.pop_back();
+		if (b - a < 2) continue;
+
+		const Vector &p0 = points[a];
+		Vector d = points[b] - p0;
+		Real dd = d.dot(d);
+		int index = -1;
+		Real max_distance2 = tolerance2;
+		for(int i = a + 1; i < b; ++i) {
+			Vector v = points[i] - p0;
+			Real t = dd > 1e-12 ? max(Real(0.0), min(Real(1.0), v.dot(d)/dd)) : 0.0;
+			Vector e = v - d*t;
+			Real distance2 = e.dot(e);
+			if (distance2 > max_distance2) { max_distance2 = distance2; index = i; }
+		}
+
+		if (index >= 0) {
+			out_keep[index] = true;
+			stack.push_back(std::make_pair(a, index));
+			stack.push_back(std::make_pair(index, b));
+		}
+	}
+}
+
+void Contour::line_to_simplified(
+	const std::vector<Vector> &points,
+	Real tolerance,
+	bool add_last,
+	std::vector<bool> &keep )
+{
+	if (points.size() < 2) return;
+	simplify(points, tolerance, keep);
+	for(size_t i = 1; i + 1 < points.size(); ++i)
+		if (keep[i]) line_to(points[i]);
+	if (add_last)
+		line_to(points.back());
+}
+
+void Contour::downgrade(Contour &c, Real tolerance) const {
+	// half of tolerance for flattening of curves and half for simplification
+	Real half_tolerance = 0.5*tolerance;
+
 	c.clear();
-	Rect r;
+	std::vector<Vector> points(1, c.current());
+	std::vector<bool> keep;
+	PushBack target(points);
+	const ChunkList &chunks = get_chunks();
 	for(Contour::ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
 		switch(i->type) {
 			case Contour::CLOSE:
+				points.push_back(i->p1);
+				c.line_to_simplified(points, half_tolerance, false, keep);
 				c.close();
-				r.p0 = r.p1 = c.current();
+				points.assign(1, c.current());
 				break;
 			case Contour::MOVE:
+				c.line_to_simplified(points, half_tolerance, true, keep);
 				c.move_to(i->p1);
-				r.p0 = r.p1 = c.current();
+				points.assign(1, c.current());
 				break;
-			case Contour::CONIC:
-			case Contour::CUBIC:
 			case Contour::LINE:
-				r = r.expand(i->p1);
-				if ( fabs(r.p1.x - r.p0.x) > min_size.x
-				  || fabs(r.p1.y - r.p0.y) > min_size.y )
-				{
-					c.line_to(i->p1);
-					r.p0 = r.p1 = c.current();
+				points.push_back(i->p1);
+				break;
+			case Contour::CONIC: {
+					Vector center;
+					Real radius = 0.0;
+					Real radians0 = 0.0;
+					Real radians1 = 0.0;
+					if (conic_convert(points.back(), i->p1, i->t0, center, radius, radians0, radians1))
+						Flatten::arc(center, radius, radians0, radians1, i->p1, half_tolerance, target);
+					else
+						points.push_back(i->p1);
+				}
+				break;
+			case Contour::CUBIC: {
+					Vector p0 = points.back();
+					Vector pp0, pp1;
+					cubic_convert(p0, i->p1, i->t0, i->t1, pp0, pp1);
+					Flatten::cubic(p0, pp0, pp1, i->p1, half_tolerance, target);
 				}
 				break;
 		}
 	}
+	c.line_to_simplified(points, half_tolerance, true, keep);
+}
+
+const std::vector<Vector>* Contour::get_triangles(bool evenodd) const {
+	TrianglesCache &cache = triangles_cache[evenodd ? 1 : 0];
+	if (!cache.valid) {
+		cache.valid = true;
+		cache.triangles.clear();
+		cache.success = Triangulator::triangulate(*this, evenodd, cache.triangles);
+	}
+	return cache.success ? &cache.triangles : NULL;
+}
+
+void Contour::build_lod(int max_levels) {
+	changed();
+	const ChunkList &chunks = *geometry;
+	if (chunks.empty()) return;
+
+	// no sense to simplify more than size of contour
+	Rect bounds(chunks.front().p1, chunks.front().p1);
+	for(ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i)
+		bounds = bounds.expand(i->p1);
+	Real size = max(bounds.p1.x - bounds.p0.x, bounds.p1.y - bounds.p0.y);
+
+	lod_levels.reserve(max_levels);
+	Real tolerance = lod_tolerance;
+	for(int i = 0; i < max_levels && tolerance < size; ++i) {
+		// every level is downgraded from source, so error is not accumulated
+		tolerance *= 2.0;
+		lod_levels.push_back(Contour());
+		downgrade(lod_levels.back(), tolerance);
+	}
+}
+
+int Contour::get_lod_level(const Affine &transform) const {
+	// tolerance of level n is lod_tolerance*2^n*scale in coordinates after transform,
+	// choose the coarsest level which is not worse than lod_tolerance
+	Real scale = lod_scale*sqrt(fabs(transform.axis_x.x*transform.axis_y.y - transform.axis_x.y*transform.axis_y.x));
+	if (lod_levels.empty() || !(scale <= 0.5)) return 0;
+	return min((int)floor(-log2(scale)), (int)lod_levels.size());
+}
+
+const Contour& Contour::get_lod(const Affine &transform) const {
+	int level = get_lod_level(transform);
+	return level > 0 ? lod_levels[level - 1] : *this;
 }
 
 void Contour::to_polyspan(Polyspan &polyspan) const {
+	const Contour &lod = get_lod();
+	if (&lod != this) { lod.to_polyspan(polyspan); return; }
+
 	polyspan.move_to(0.0, 0.0);
-	Vector p0;
-	for(Contour::ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+	to_polyspan(polyspan, 0, (int)geometry->size());
+}
+
+void Contour::to_polyspan(Polyspan &polyspan, int begin, int end) const {
+	assert(begin >= 0 && begin <= end && end <= (int)geometry->size());
+
+	const ContextRect &w = polyspan.get_window();
+	Rect window(w.minx, w.miny, w.maxx, w.maxy);
+
+	// transformation is applied on the fly
+	Vector p0 = begin > 0 ? matrix.transform((*geometry)[begin - 1].p1) : Vector();
+	for(Contour::ChunkList::const_iterator i = geometry->begin() + begin; i != geometry->begin() + end; ++i) {
+		Vector p1 = matrix.transform(i->p1);
 		switch(i->type) {
 			case Contour::CLOSE:
 				polyspan.close();
 				break;
 			case Contour::MOVE:
-				polyspan.move_to(i->p1.x, i->p1.y);
+				polyspan.move_to(p1.x, p1.y);
 				break;
 			case Contour::LINE:
-				polyspan.line_to(i->p1.x, i->p1.y);
+				polyspan.line_to(p1.x, p1.y);
 				break;
 			case Contour::CONIC: {
 					Vector center;
 					Real radius = 0.0;
 					Real radians0 = 0.0;
 					Real radians1 = 0.0;
-					if (conic_convert(p0, i->p1, i->t0, center, radius, radians0, radians1)) {
-						// TODO: fix bugs
-						Vector pp0( center.x + 2.0*radius*cos(0.5*(radians0 + radians1)),
-								    center.y + 2.0*radius*sin(0.5*(radians0 + radians1)) );
-						polyspan.conic_to(pp0.x, pp0.y, i->p1.x, i->p1.y);
+					if ( conic_convert(p0, p1, matrix.transform_vector(i->t0), center, radius, radians0, radians1)
+					  && window.intersects(conic_bounds(p0, p1, center, radius, radians0, radians1)) )
+					{
+						Polyspan::LineTo target(polyspan);
+						Flatten::arc(center, radius, radians0, radians1, p1, Flatten::default_tolerance, target);
 					} else {
-						polyspan.line_to(i->p1.x, i->p1.y);
+						polyspan.line_to(p1.x, p1.y);
 					}
 				}
 				break;
 			case Contour::CUBIC: {
 					Vector pp0, pp1;
-					cubic_convert(p0, i->p1, i->t0, i->t1, pp0, pp1);
-					polyspan.cubic_to(pp0.x, pp0.y, pp1.x, pp1.y, i->p1.x, i->p1.y);
+					cubic_convert(p0, p1, matrix.transform_vector(i->t0), matrix.transform_vector(i->t1), pp0, pp1);
+					polyspan.cubic_to(pp0.x, pp0.y, pp1.x, pp1.y, p1.x, p1.y);
 				}
 				break;
 			default:
 				break;
 		}
-		p0 = i->p1;
+		p0 = p1;
 	}
 }
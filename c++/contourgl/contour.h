@@ -19,8 +19,10 @@
 #define _CONTOUR_H_
 
 #include <vector>
+#include <memory>
 
 #include "geometry.h"
+#include "flatten.h"
 #include "polyspan.h"
 
 class Contour
@@ -44,15 +46,83 @@ public:
 
 	typedef std::vector<Chunk> ChunkList;
 
+	enum ShapeType {
+		GENERAL,
+		CONVEX,
+		RECTANGLE
+	};
+
 private:
+	// receives points of flattened curves
+	struct LineSplit {
+		Contour &contour;
+		Rect &ref_line_bounds;
+		const Rect &bounds;
+		const Vector &min_size;
+		LineSplit(Contour &contour, Rect &ref_line_bounds, const Rect &bounds, const Vector &min_size):
+			contour(contour), ref_line_bounds(ref_line_bounds), bounds(bounds), min_size(min_size) { }
+		void operator() (const Vector &p)
+			{ contour.line_split(ref_line_bounds, bounds, min_size, p); }
+	};
+
+	// collects points of flattened curves
+	struct PushBack {
+		std::vector<Vector> &points;
+		explicit PushBack(std::vector<Vector> &points): points(points) { }
+		void operator() (const Vector &p) { points.push_back(p); }
+	};
+
+	struct TrianglesCache {
+		bool valid;
+		bool success;
+		std::vector<Vector> triangles;
+		TrianglesCache(): valid(), success() { }
+	};
+
 	static const Vector blank;
-	ChunkList chunks;
+
+	// geometry is shared between copies of contour and copied before editing,
+	// transformation matrix is not applied to geometry immediately: it is applied
+	// on the fly by to_polyspan and PathStore, or once by get_chunks when needed
+	std::shared_ptr<ChunkList> geometry;
+	Affine matrix;
+	mutable std::shared_ptr<ChunkList> transformed;
 	size_t first;
 
+	// bounds are calculated once, bounds of geometry are kept while contour is transformed
+	mutable Rect geometry_bounds;
+	mutable Rect bounds;
+	mutable bool geometry_bounds_valid;
+	mutable bool bounds_valid;
+
+	// shape of geometry, it is kept while contour is only transformed
+	mutable std::vector<Vector> shape_points;
+	mutable ShapeType shape;
+	mutable bool shape_valid;
+
+	// separate triangulations for non-zero and even-odd fill rules
+	mutable TrianglesCache triangles_cache[2];
+
+	// simplified copies of contour, item n is the level n+1,
+	// lod_scale is the scale of all transformations applied after build
+	std::vector<Contour> lod_levels;
+	Real lod_scale;
+
+	static Rect chunks_bounds(const ChunkList &chunks);
+
+	void reset_triangles();
+	void changed();
+
 public:
 	bool allow_split_lines;
 
-	Contour(): first(0), allow_split_lines() { }
+	// level n of detail is downgraded with this tolerance multiplied by 2^n
+	static const Real lod_tolerance;
+
+	Contour():
+		geometry(std::make_shared<ChunkList>()), first(0),
+		geometry_bounds_valid(), bounds_valid(), shape(), shape_valid(),
+		lod_scale(1.0), allow_split_lines() { }
 
 	void clear();
 	void move_to(const Vector &v);
@@ -61,15 +131,61 @@ public:
 	void conic_to(const Vector &v, const Vector &t);
 	void close();
 
-	const ChunkList& get_chunks() const { return chunks; }
+	// replaces chunk, coordinates are after transformation of contour
+	void set_chunk(int index, const Chunk &chunk);
+
+	// transformed chunks
+	const ChunkList& get_chunks() const;
+	// chunks before transformation by matrix
+	const ChunkList& get_geometry() const { return *geometry; }
+	// geometry stays unchanged while pointer is held, contour takes own copy before editing
+	std::shared_ptr<const ChunkList> get_geometry_ptr() const { return geometry; }
+	const Affine& get_matrix() const { return matrix; }
+	// bounds of transformed contour including curves, may be larger for rotated contours
+	Rect get_bounds() const;
+
+	// shape of geometry before transformation by matrix: single closed polygon which is convex
+	// or is axis-aligned rectangle, classified once and kept until contour is changed
+	ShapeType get_shape() const;
+	// vertices of convex polygon or rectangle, empty for general shape
+	const std::vector<Vector>& get_shape_points() const
+		{ get_shape(); return shape_points; }
 
 	const Vector& current() const
-		{ return chunks.empty() ? blank : chunks.back().p1; }
+		{ return get_chunks().empty() ? blank : get_chunks().back().p1; }
 
-	void split(Contour &c, const Rect &bounds, const Vector &min_size) const;
-	void downgrade(Contour &c, const Vector &min_size) const;
+	// curves are flattened with given maximal distance between curve and polyline
+	void split(
+		Contour &c,
+		const Rect &bounds,
+		const Vector &min_size,
+		Real tolerance = Flatten::default_tolerance ) const;
+	// converts curves to lines and removes points,
+	// result differs from source not more than tolerance (in pixels)
+	void downgrade(Contour &c, Real tolerance) const;
 	void transform(const Rect &from, const Rect &to);
+	void transform(const Affine &matrix);
 	void to_polyspan(Polyspan &polyspan) const;
+	// sends chunks [begin, end) without levels of detail,
+	// pen of polyspan should be placed at the end of chunk begin-1 by caller
+	void to_polyspan(Polyspan &polyspan, int begin, int end) const;
+
+	// triangles of filled area (three vertices per triangle), calculated by Triangulator once
+	// and kept until contour changes, returns NULL when contour cannot be triangulated
+	const std::vector<Vector>* get_triangles(bool evenodd) const;
+
+	// builds levels of detail up to the size of contour,
+	// levels are kept while contour is only transformed
+	void build_lod(int max_levels = 16);
+	int get_lod_count() const { return (int)lod_levels.size(); }
+	int get_lod_level() const
+		{ return get_lod_level(Affine()); }
+	// simplified contour for the current scale, or this contour
+	const Contour& get_lod() const
+		{ return get_lod(Affine()); }
+	// level for contour which will be drawn with additional transformation
+	int get_lod_level(const Affine &transform) const;
+	const Contour& get_lod(const Affine &transform) const;
 
 private:
 	void line_split(
@@ -88,7 +204,7 @@ private:
 		Real radius,
 		Real radians0,
 		Real radians1,
-		int level = 64 );
+		Real tolerance );
 
 	void cubic_split(
 		Rect &ref_line_bounds,
@@ -97,8 +213,23 @@ private:
 		const Vector &p1,
 		const Vector &bezier_pp0,
 		const Vector &bezier_pp1,
-		int level = 64 );
+		Real tolerance );
+
+	// adds lines to simplified polyline, first point must be equal to current point
+	void line_to_simplified(
+		const std::vector<Vector> &points,
+		Real tolerance,
+		bool add_last,
+		std::vector<bool> &keep );
 
+	// marks points which should be kept to hold distance from source polyline not more than tolerance
+	static void simplify(
+		const std::vector<Vector> &points,
+		Real tolerance,
+		std::vector<bool> &out_keep );
+
+public:
+	// circle arc by end points and tangent at start
 	static bool conic_convert(
 		const Vector &p0,
 		const Vector &p1,
@@ -116,6 +247,7 @@ private:
 		Real radians0,
 		Real radians1 );
 
+	// bezier control points by end points and tangents
 	static void cubic_convert(
 		const Vector &p0,
 		const Vector &p1,
@@ -124,6 +256,9 @@ private:
 		Vector &out_bezier_pp0,
 		Vector &out_bezier_pp1 );
 
+	// shape of closed polygon without repeated vertices
+	static ShapeType classify(const std::vector<Vector> &points);
+
 	static Rect cubic_bounds(
 		const Vector &p0,
 		const Vector &p1,
@@ -97,7 +97,7 @@ void ContourBuilder::build_car(Contour &c, const Vector &o, Real s) {
 	c.close();
 }
 
-void ContourBuilder::build(Contour &c) {
+void ContourBuilder::build_instances(std::vector<Affine> &transforms) {
 	Real scale = 0.8/5.0;
 
 	int count = 100;
@@ -107,7 +107,8 @@ void ContourBuilder::build(Contour &c) {
 	Real s = 2*size*scale/(Real)(count);
 	for(int i = 0; i < count; ++i)
 		for(int j = 0; j < count; ++j)
-			build_car(c, Vector(origin + i*step, origin + j*step), s);
+			transforms.push_back( Affine::translation(Vector(origin + i*step, origin + j*step))
+			                    * Affine::scaling(Vector(s, s)) );
 
 	count = 100;
 	size = (Real)(count + 2)/(Real)(count);
@@ -116,9 +117,16 @@ void ContourBuilder::build(Contour &c) {
 	s = size*scale/(Real)(count);
 	for(int i = 0; i < count; ++i)
 		for(int j = 0; j < count; ++j)
-			build_car(c, Vector(origin + i*step, origin + j*step), s);
+			transforms.push_back( Affine::translation(Vector(origin + i*step, origin + j*step))
+			                    * Affine::scaling(Vector(s, s)) );
 
-	build_car(c, Vector::zero(), scale);
-	build_car(c, Vector::zero(), 0.5*scale);
+	transforms.push_back(Affine::scaling(Vector(scale, scale)));
+	transforms.push_back(Affine::scaling(Vector(0.5*scale, 0.5*scale)));
 }
 
+void ContourBuilder::build(Contour &c) {
+	std::vector<Affine> transforms;
+	build_instances(transforms);
+	for(std::vector<Affine>::const_iterator i = transforms.begin(); i != transforms.end(); ++i)
+		build_car(c, i->offset, i->axis_x.x);
+}
@@ -21,5 +21,7 @@ class ContourBuilder {
 public:
 	static void build_simple(std::vector<Vector> &c);
 	static void build_car(Contour &c, const Vector &o, Real s);
+	// placements of cars built by build()
+	static void build_instances(std::vector<Affine> &transforms);
 	static void build(Contour &c);
 };
@@ -16,15 +16,18 @@
 */
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 #include "test.h"
 #include "measure.h"
+#include "renderer.h"
 
 
 using namespace std;
 
 
-int main() {
+int main(int argc, char **argv) {
 	int width = 512;
 	int height = 512;
 
@@ -40,6 +43,65 @@ int main() {
 	bounds_gl.p0 = Vector(-1.0, -1.0);
 	bounds_gl.p1 = Vector( 1.0,  1.0);
 
+	if (argc > 1 && string(argv[1]) == "tune") {
+		// choose OpenCL workgroup sizes for current device and store them into profile
+
+		Test::Data data;
+		Test::load(data, "lines.txt");
+		Test::transform(data, bounds_file, bounds_frame);
+
+		Environment e(width, height, false, false, 8);
+		Surface surface(width, height);
+		Test::tune_cl(e, data, surface);
+
+		cout << "done" << endl;
+		return 0;
+	}
+
+	if (argc > 1 && string(argv[1]) == "render") {
+		// draw lines by renderers chosen by name, only needed contexts are created
+
+		vector<string> names(argv + 2, argv + argc);
+		if (names.empty()) {
+			cout << "usage: " << argv[0] << " render <name> [<name> ...]" << endl
+				 << "renderers:";
+			vector<string> all = Renderer::get_names();
+			for(vector<string>::const_iterator i = all.begin(); i != all.end(); ++i)
+				cout << " " << *i;
+			cout << endl;
+			return 0;
+		}
+
+		Test::Data data;
+		Test::load(data, "lines.txt");
+		Test::transform(data, bounds_file, bounds_frame);
+
+		Environment e(width, height, false, false, 8);
+		for(vector<string>::const_iterator i = names.begin(); i != names.end(); ++i) {
+			Surface surface(width, height);
+			Measure t("test_lines_" + *i + ".tga", surface, true);
+			Test::test_renderer(e, *i, data, surface);
+		}
+
+		cout << "done" << endl;
+		return 0;
+	}
+
+	if (argc > 1 && string(argv[1]) == "instances") {
+		// draw many instances of one contour by renderers chosen by name
+
+		vector<string> names(argv + 2, argv + argc);
+		Environment e(width, height, false, false, 8);
+		for(vector<string>::const_iterator i = names.begin(); i != names.end(); ++i) {
+			Surface surface(width, height);
+			Measure t("test_instances_" + *i + ".tga", surface, true);
+			Test::test_instances(e, *i, surface);
+		}
+
+		cout << "done" << endl;
+		return 0;
+	}
+
 	{
 		// lines
 
@@ -86,11 +148,50 @@ int main() {
 		  Measure t("test_lineslow_gl_stencil_aa.tga", true);
 		  Test::test_gl_stencil(e, gldata); }
 		*/
+		{ Environment e(width, height, false, false, 8);
+		  Measure t("test_lineslow_gl_batch.tga", true);
+		  Test::test_gl_batch(e, datalow); }
+		{ Environment e(width, height, false, false, 8);
+		  Measure t("test_lineslow_gl_triangles.tga", true);
+		  Test::test_gl_batch(e, datalow, true); }
+		{ Environment e(width, height, false, false, 8);
+		  Measure t("test_lineslow_gl_compute.tga", true);
+		  Test::test_gl_compute(e, datalow); }
+		{ Environment e(width, height, false, false, 8);
+		  Measure t("test_lineslow_gl_readback");
+		  Test::test_gl_readback(e, datalow); }
 		{
 			Environment e(width, height, false, false, 8);
 			{ Surface surface(width, height);
 			  Measure t("test_lineslow_sw.tga", surface, true);
 			  Test::test_sw(e, datalow, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lineslow_sw_store.tga", surface, true);
+			  Test::test_sw_store(e, datalow, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lineslow_sw_pan.tga", surface, true);
+			  Test::test_sw_pan(e, datalow, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lineslow_sw_scene.tga", surface, true);
+			  Test::test_sw_scene(e, datalow, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lineslow_sw_occlusion.tga", surface, true);
+			  Test::test_sw_occlusion(e, datalow, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lineslow_sw_parallel.tga", surface, true);
+			  Test::test_sw_parallel(e, datalow, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lineslow_sw_band.tga", surface, true);
+			  Test::test_sw_band(e, datalow, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lineslow_sw_batch.tga", surface, true);
+			  Test::test_sw_batch(e, datalow, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lineslow_sw_split.tga", surface, true);
+			  Test::test_sw_split(e, datalow, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_sw_edit.tga", surface, true);
+			  Test::test_sw_edit(e, surface); }
 			/*
 			{ Surface surface(width, height);
 			  Measure t("test_lineslow_cl.tga", surface, true);
@@ -102,9 +203,53 @@ int main() {
 			{ Surface surface(width, height);
 			  Measure t("test_lineslow_cl3.tga", surface, true);
 			  Test::test_cl3(e, datalow, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lineslow_cl3_transform.tga", surface, true);
+			  Test::test_cl3_transform(e, datalow, surface); }
 			{ Surface surface(width, height);
 			  Measure t("test_lineslow_cu.tga", surface, true);
 			  Test::test_cu(e, datalow, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lineslow_hybrid.tga", surface, true);
+			  Test::test_hybrid(e, datalow, surface); }
+		}
+
+		{
+			// zoomed out frame, full detail and levels of detail
+			Rect bounds_zoomed;
+			bounds_zoomed.p0 = Vector(0.4375*width, 0.4375*height);
+			bounds_zoomed.p1 = Vector(0.5625*width, 0.5625*height);
+
+			Test::Data zoomed = data, zoomed_lod = data;
+			Test::build_lod(zoomed_lod);
+			Test::transform(zoomed, bounds_frame, bounds_zoomed);
+			Test::transform(zoomed_lod, bounds_frame, bounds_zoomed);
+
+			Environment e(width, height, false, false, 8);
+			{ Surface surface(width, height);
+			  Measure t("test_lines_zoomed_sw.tga", surface, true);
+			  Test::test_sw(e, zoomed, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lines_zoomed_lod_sw.tga", surface, true);
+			  Test::test_sw(e, zoomed_lod, surface); }
+		}
+
+		{
+			// zoomed in frame, all contours and only visible ones
+			Rect bounds_zoomed;
+			bounds_zoomed.p0 = Vector(-3.5*width, -3.5*height);
+			bounds_zoomed.p1 = Vector( 4.5*width,  4.5*height);
+
+			Test::Data zoomed = data;
+			Test::transform(zoomed, bounds_frame, bounds_zoomed);
+
+			Environment e(width, height, false, false, 8);
+			{ Surface surface(width, height);
+			  Measure t("test_lines_zoomed_in_sw.tga", surface, true);
+			  Test::test_sw(e, zoomed, surface); }
+			{ Surface surface(width, height);
+			  Measure t("test_lines_zoomed_in_culled_sw.tga", surface, true);
+			  Test::test_sw_culled(e, zoomed, surface); }
 		}
 	}
 
@@ -0,0 +1,204 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cassert>
+
+#include <algorithm>
+
+#include "contourraster.h"
+
+
+using namespace std;
+
+
+bool ContourRaster::Edge::operator== (const Edge &other) const {
+	return type == other.type
+		&& from.x == other.from.x && from.y == other.from.y
+		&& p0.x == other.p0.x && p0.y == other.p0.y
+		&& p1.x == other.p1.x && p1.y == other.p1.y
+		&& t0.x == other.t0.x && t0.y == other.t0.y
+		&& t1.x == other.t1.x && t1.y == other.t1.y;
+}
+
+void ContourRaster::init(const ContextRect &window) {
+	this->window = window;
+	edges.clear();
+	rows.clear();
+	rows.resize(max(0, window.maxy - window.miny));
+	sorted_rows.clear();
+	sorted_rows.resize(rows.size(), true);
+}
+
+void ContourRaster::init(int minx, int miny, int maxx, int maxy) {
+	ContextRect window;
+	window.minx = minx;
+	window.miny = miny;
+	window.maxx = maxx;
+	window.maxy = maxy;
+	init(window);
+}
+
+void ContourRaster::build_edges(const Contour &contour, vector<Edge> &out_edges) const {
+	// repeats state of polyspan while Contour::to_polyspan is called
+	const Contour::ChunkList &chunks = contour.get_chunks();
+	out_edges.clear();
+	out_edges.resize(chunks.size());
+
+	Vector current, close, p0;
+	bool closed = true;
+	for(int i = 0; i < (int)chunks.size(); ++i) {
+		const Contour::Chunk &chunk = chunks[i];
+		Edge &edge = out_edges[i];
+		edge.from = current;
+		edge.p0 = p0;
+		switch(chunk.type) {
+			case Contour::CLOSE:
+			case Contour::MOVE:
+				if (!closed && (current.x != close.x || current.y != close.y)) {
+					edge.type = Contour::LINE;
+					edge.p1 = close;
+				}
+				closed = true;
+				current = chunk.type == Contour::MOVE ? chunk.p1 : close;
+				if (chunk.type == Contour::MOVE) close = chunk.p1;
+				break;
+			case Contour::LINE:
+			case Contour::CONIC:
+			case Contour::CUBIC:
+				edge.type = chunk.type;
+				edge.p1 = chunk.p1;
+				edge.t0 = chunk.t0;
+				edge.t1 = chunk.t1;
+				closed = false;
+				current = chunk.p1;
+				break;
+			default:
+				break;
+		}
+		p0 = chunk.p1;
+	}
+}
+
+void ContourRaster::add_cells(int index) {
+	Edge &edge = edges[index];
+	edge.miny = edge.maxy = 0;
+	if (edge.type == Contour::MOVE) return;
+
+	Polyspan &polyspan = edge_polyspan;
+	polyspan.init(window);
+	polyspan.move_to(edge.from.x, edge.from.y);
+	switch(edge.type) {
+		case Contour::LINE:
+			polyspan.line_to(edge.p1.x, edge.p1.y);
+			break;
+		case Contour::CONIC: {
+				Rect w(window.minx, window.miny, window.maxx, window.maxy);
+				Vector center;
+				Real radius = 0.0;
+				Real radians0 = 0.0;
+				Real radians1 = 0.0;
+				if ( Contour::conic_convert(edge.p0, edge.p1, edge.t0, center, radius, radians0, radians1)
+				  && w.intersects(Contour::conic_bounds(edge.p0, edge.p1, center, radius, radians0, radians1)) )
+				{
+					Polyspan::LineTo target(polyspan);
+					Flatten::arc(center, radius, radians0, radians1, edge.p1, Flatten::default_tolerance, target);
+				} else {
+					polyspan.line_to(edge.p1.x, edge.p1.y);
+				}
+			}
+			break;
+		case Contour::CUBIC: {
+				Vector pp0, pp1;
+				Contour::cubic_convert(edge.p0, edge.p1, edge.t0, edge.t1, pp0, pp1);
+				polyspan.cubic_to(pp0.x, pp0.y, pp1.x, pp1.y, edge.p1.x, edge.p1.y);
+			}
+			break;
+		default:
+			break;
+	}
+	polyspan.sort_marks();
+
+	const Polyspan::cover_array &marks = polyspan.get_covers();
+	if (marks.empty()) return;
+	edge.miny = marks.front().y - window.miny;
+	edge.maxy = marks.back().y - window.miny + 1;
+	assert(edge.miny >= 0 && edge.maxy <= (int)rows.size());
+
+	Cell cell;
+	cell.edge = index;
+	for(Polyspan::cover_array::const_iterator i = marks.begin(); i != marks.end(); ++i) {
+		int row = i->y - window.miny;
+		cell.mark = *i;
+		rows[row].push_back(cell);
+		sorted_rows[row] = false;
+	}
+}
+
+void ContourRaster::remove_cells(int index) {
+	// order of other cells is kept, so rows stay sorted
+	const Edge &edge = edges[index];
+	for(int i = edge.miny; i < edge.maxy; ++i) {
+		Row &row = rows[i];
+		Row::iterator j = row.begin();
+		for(Row::iterator k = row.begin(); k != row.end(); ++k)
+			if (k->edge != index) *j++ = *k;
+		row.erase(j, row.end());
+	}
+}
+
+int ContourRaster::update(const Contour &contour) {
+	vector<Edge> new_edges;
+	build_edges(contour, new_edges);
+
+	int old_count = (int)edges.size();
+	int new_count = (int)new_edges.size();
+	vector<bool> changed(max(old_count, new_count), true);
+	for(int i = 0; i < old_count && i < new_count; ++i)
+		changed[i] = !(edges[i] == new_edges[i]);
+
+	for(int i = 0; i < old_count; ++i)
+		if (changed[i]) remove_cells(i);
+
+	edges.resize(new_count);
+	int count = 0;
+	for(int i = 0; i < new_count; ++i) {
+		if (changed[i]) {
+			edges[i] = new_edges[i];
+			add_cells(i);
+			++count;
+		}
+	}
+	return count;
+}
+
+void ContourRaster::to_polyspan(Polyspan &polyspan) {
+	// rows are sorted by x, so whole array is sorted by y and x
+	covers.clear();
+	for(int i = 0; i < (int)rows.size(); ++i) {
+		Row &row = rows[i];
+		if (!sorted_rows[i]) {
+			sort(row.begin(), row.end());
+			sorted_rows[i] = true;
+		}
+		for(Row::const_iterator j = row.begin(); j != row.end(); ++j)
+			covers.push_back(j->mark);
+	}
+
+	polyspan.init(window);
+	polyspan.swap_sorted_covers(covers);
+}
@@ -0,0 +1,82 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _CONTOURRASTER_H_
+#define _CONTOURRASTER_H_
+
+#include <vector>
+
+#include "geometry.h"
+#include "contour.h"
+#include "polyspan.h"
+
+
+// Cells of contour rasterized edge by edge, for interactive editing of large contours.
+// Cells of every edge are kept in rows of window with index of edge,
+// update() compares edges of edited contour with previous ones, removes cells of changed edges
+// and rasterizes only them, then only touched rows are sorted again.
+// Result is the same as of Contour::to_polyspan for contour without levels of detail.
+class ContourRaster {
+private:
+	// one edge per chunk of contour, MOVE and CLOSE chunks may have closing line
+	struct Edge {
+		// LINE, CONIC or CUBIC, MOVE for chunk without cells
+		Contour::ChunkType type;
+		// current point of polyspan and end point of previous chunk (they differ after close)
+		Vector from, p0;
+		Vector p1, t0, t1;
+		// rows of window with cells of edge
+		int miny, maxy;
+
+		Edge(): type(Contour::MOVE), miny(), maxy() { }
+		bool operator== (const Edge &other) const;
+	};
+
+	struct Cell {
+		Polyspan::PenMark mark;
+		int edge;
+		bool operator< (const Cell &other) const
+			{ return mark.x < other.mark.x; }
+	};
+
+	typedef std::vector<Cell> Row;
+
+	ContextRect window;
+	std::vector<Edge> edges;
+	std::vector<Row> rows;
+	std::vector<bool> sorted_rows;
+	Polyspan edge_polyspan;
+	Polyspan::cover_array covers;
+
+	void build_edges(const Contour &contour, std::vector<Edge> &out_edges) const;
+	void add_cells(int index);
+	void remove_cells(int index);
+
+public:
+	void init(const ContextRect &window);
+	void init(int minx, int miny, int maxx, int maxy);
+
+	// rasterizes changed edges of contour, returns count of them
+	int update(const Contour &contour);
+
+	int get_edges_count() const { return (int)edges.size(); }
+
+	void to_polyspan(Polyspan &polyspan);
+};
+
+#endif
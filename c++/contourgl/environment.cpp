@@ -16,3 +16,55 @@
 */
 
 #include "environment.h"
+
+
+Environment::Environment(int width, int height, bool hdr, bool multisample, int samples, GlContext::Platform platform):
+	width(width),
+	height(height),
+	hdr(hdr),
+	multisample(multisample),
+	samples(samples),
+	platform(platform),
+	gl_context(),
+	cl_context(),
+	gl_shaders()
+	#ifdef CUDA
+	, cu_context()
+	#endif
+{ }
+
+Environment::~Environment() {
+	#ifdef CUDA
+	delete cu_context;
+	#endif
+	delete gl_shaders;
+	delete cl_context;
+	delete gl_context;
+}
+
+GlContext& Environment::gl() {
+	if (!gl_context)
+		gl_context = new GlContext(width, height, hdr, multisample, samples, platform);
+	return *gl_context;
+}
+
+ClContext& Environment::cl() {
+	if (!cl_context)
+		cl_context = new ClContext();
+	return *cl_context;
+}
+
+Shaders& Environment::shaders() {
+	// shaders need current GL context
+	if (!gl_shaders)
+		{ gl().use(); gl_shaders = new Shaders(); }
+	return *gl_shaders;
+}
+
+#ifdef CUDA
+CudaContext& Environment::cu() {
+	if (!cu_context)
+		cu_context = new CudaContext();
+	return *cu_context;
+}
+#endif
@@ -26,20 +26,41 @@
 #include "cudacontext.h"
 #endif
 
+// Contexts are created by the first request, so CPU-only run doesn't touch GPU at all.
 class Environment {
+private:
+	int width;
+	int height;
+	bool hdr;
+	bool multisample;
+	int samples;
+	GlContext::Platform platform;
+
+	GlContext *gl_context;
+	ClContext *cl_context;
+	Shaders *gl_shaders;
+
+	#ifdef CUDA
+	CudaContext *cu_context;
+	#endif
+
+	Environment(const Environment&) { }
+	Environment& operator= (const Environment&) { return *this; }
+
 public:
-	GlContext gl;
-	ClContext cl;
-	Shaders shaders;
+	Environment(int width, int height, bool hdr, bool multisample, int samples, GlContext::Platform platform = GlContext::PLATFORM_AUTO);
+	~Environment();
+
+	GlContext& gl();
+	ClContext& cl();
+	Shaders& shaders();
 
 	#ifdef CUDA
-	CudaContext cu;
+	CudaContext& cu();
 	#endif
 
-	Environment(int width, int height, bool hdr, bool multisample, int samples):
-		gl(width, height, hdr, multisample, samples) { }
-	void use() { gl.use(); }
-	void unuse() { gl.unuse(); }
+	void use() { gl().use(); }
+	void unuse() { if (gl_context) gl_context->unuse(); }
 };
 
 #endif
@@ -0,0 +1,54 @@
+/*
+    ......... 2015 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+
+#include "flatten.h"
+
+
+using namespace std;
+
+
+const Real Flatten::default_tolerance = 0.1;
+
+
+static int clamp_segments(Real count) {
+	return count < 1.0 ? 1
+		 : count > (Real)Flatten::max_segments ? Flatten::max_segments
+		 : (int)ceil(count);
+}
+
+static Real second_difference(const Vector &p0, const Vector &p1, const Vector &p2) {
+	Vector d = p0 - p1*2.0 + p2;
+	return sqrt(d.dot(d));
+}
+
+int Flatten::conic_segments(const Vector &p0, const Vector &p1, const Vector &p2, Real tolerance) {
+	return clamp_segments(sqrt(0.25*second_difference(p0, p1, p2)/tolerance));
+}
+
+int Flatten::cubic_segments(const Vector &p0, const Vector &p1, const Vector &p2, const Vector &p3, Real tolerance) {
+	Real d = max(second_difference(p0, p1, p2), second_difference(p1, p2, p3));
+	return clamp_segments(sqrt(0.75*d/tolerance));
+}
+
+int Flatten::arc_segments(Real radius, Real radians, Real tolerance) {
+	radius = fabs(radius);
+	radians = fabs(radians);
+	if (radius <= tolerance) return clamp_segments(radians/M_PI);
+	return clamp_segments(radians/(2.0*acos(1.0 - tolerance/radius)));
+}
@@ -0,0 +1,101 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _FLATTEN_H_
+#define _FLATTEN_H_
+
+#include "geometry.h"
+
+
+// Converts curves to polylines with the given maximal distance between curve and polyline.
+// Count of segments is calculated once per curve (Wang's formula for beziers,
+// sagitta of chord for circle arcs), then points are evaluated by forward differencing,
+// so there is no recursion and no trigonometry per point.
+// Target is called for each point of polyline except the first one (current point),
+// last point is always exactly equal to the end point of curve.
+class Flatten {
+public:
+	// distance in pixels
+	static const Real default_tolerance;
+	static const int max_segments = 65536;
+
+	static int conic_segments(const Vector &p0, const Vector &p1, const Vector &p2, Real tolerance);
+	static int cubic_segments(const Vector &p0, const Vector &p1, const Vector &p2, const Vector &p3, Real tolerance);
+	static int arc_segments(Real radius, Real radians, Real tolerance);
+
+	// quadratic bezier
+	template<typename T>
+	static void conic(const Vector &p0, const Vector &p1, const Vector &p2, Real tolerance, T &target) {
+		int count = conic_segments(p0, p1, p2, tolerance);
+		if (count > 1) {
+			Real h = 1.0/count;
+			Vector a = p0 - p1*2.0 + p2;
+			Vector b = (p1 - p0)*2.0;
+			Vector ddf = a*(2.0*h*h);
+			Vector df = a*(h*h) + b*h;
+			Vector f = p0;
+			for(int i = 1; i < count; ++i) {
+				f = f + df;
+				df = df + ddf;
+				target(f);
+			}
+		}
+		target(p2);
+	}
+
+	// cubic bezier
+	template<typename T>
+	static void cubic(const Vector &p0, const Vector &p1, const Vector &p2, const Vector &p3, Real tolerance, T &target) {
+		int count = cubic_segments(p0, p1, p2, p3, tolerance);
+		if (count > 1) {
+			Real h = 1.0/count;
+			Vector a = (p1 - p2)*3.0 + p3 - p0;
+			Vector b = (p0 - p1*2.0 + p2)*3.0;
+			Vector c = (p1 - p0)*3.0;
+			Vector dddf = a*(6.0*h*h*h);
+			Vector ddf = dddf + b*(2.0*h*h);
+			Vector df = a*(h*h*h) + b*(h*h) + c*h;
+			Vector f = p0;
+			for(int i = 1; i < count; ++i) {
+				f = f + df;
+				df = df + ddf;
+				ddf = ddf + dddf;
+				target(f);
+			}
+		}
+		target(p3);
+	}
+
+	// circle arc from angle radians0 to angle radians1 ending at p1,
+	// points are rotated around center by precalculated step
+	template<typename T>
+	static void arc(const Vector &center, Real radius, Real radians0, Real radians1, const Vector &p1, Real tolerance, T &target) {
+		int count = arc_segments(radius, radians1 - radians0, tolerance);
+		if (count > 1) {
+			Real step = (radians1 - radians0)/count;
+			Real s = sin(step), c = cos(step);
+			Vector v(radius*cos(radians0), radius*sin(radians0));
+			for(int i = 1; i < count; ++i) {
+				v = Vector(v.x*c - v.y*s, v.x*s + v.y*c);
+				target(center + v);
+			}
+		}
+		target(p1);
+	}
+};
+
+#endif
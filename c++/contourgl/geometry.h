@@ -131,13 +131,99 @@ public:
     rect(const type &x0, const type &y0, const type &x1, const type &y1): p0(x0, y0), p1(x1, y1) { }
 };
 
+// 2x3 affine matrix, maps point p to axis_x*p.x + axis_y*p.y + offset
+template<typename T>
+class affine2 {
+public:
+	typedef T type;
+
+	vec2<type> axis_x, axis_y, offset;
+
+	affine2():
+		axis_x(type(1), type()), axis_y(type(), type(1)) { }
+	affine2(const vec2<type> &axis_x, const vec2<type> &axis_y, const vec2<type> &offset):
+		axis_x(axis_x), axis_y(axis_y), offset(offset) { }
+
+	template<typename TT>
+	explicit affine2(const affine2<TT> &other):
+		axis_x(other.axis_x), axis_y(other.axis_y), offset(other.offset) { }
+
+	bool is_identity() const {
+		return axis_x.x == type(1) && axis_x.y == type()
+			&& axis_y.x == type() && axis_y.y == type(1)
+			&& offset.x == type() && offset.y == type();
+	}
+
+	// rotation, uniform scaling, reflection and translation, circles stay circles
+	bool is_conformal() const {
+		type xx = axis_x.x*axis_x.x + axis_x.y*axis_x.y;
+		type yy = axis_y.x*axis_y.x + axis_y.y*axis_y.y;
+		type xy = axis_x.x*axis_y.x + axis_x.y*axis_y.y;
+		type e = type(1e-5)*(xx + yy);
+		return fabs(xy) <= e && fabs(xx - yy) <= e;
+	}
+
+	vec2<type> transform(const vec2<type> &p) const
+		{ return axis_x*p.x + axis_y*p.y + offset; }
+	vec2<type> transform_vector(const vec2<type> &v) const
+		{ return axis_x*v.x + axis_y*v.y; }
+
+	// transform arrays in place, loops are simple enough to be vectorized by compiler
+	void transform_points(vec2<type> *points, int count) const {
+		const type xx = axis_x.x, xy = axis_x.y, yx = axis_y.x, yy = axis_y.y, ox = offset.x, oy = offset.y;
+		for(vec2<type> *p = points, *end = points + count; p < end; ++p) {
+			const type x = p->x, y = p->y;
+			p->x = xx*x + yx*y + ox;
+			p->y = xy*x + yy*y + oy;
+		}
+	}
+	void transform_vectors(vec2<type> *vectors, int count) const {
+		const type xx = axis_x.x, xy = axis_x.y, yx = axis_y.x, yy = axis_y.y;
+		for(vec2<type> *v = vectors, *end = vectors + count; v < end; ++v) {
+			const type x = v->x, y = v->y;
+			v->x = xx*x + yx*y;
+			v->y = xy*x + yy*y;
+		}
+	}
+
+	// bounds of transformed rectangle
+	rect<type> transform_bounds(const rect<type> &r) const {
+		vec2<type> p = transform(r.p0);
+		return rect<type>(p, p)
+			.expand(transform(vec2<type>(r.p1.x, r.p0.y)))
+			.expand(transform(vec2<type>(r.p0.x, r.p1.y)))
+			.expand(transform(r.p1));
+	}
+
+	// result applies other matrix first and then this one
+	affine2 operator*(const affine2 &other) const
+		{ return affine2(transform_vector(other.axis_x), transform_vector(other.axis_y), transform(other.offset)); }
+
+	static affine2 identity()
+		{ return affine2(); }
+	static affine2 translation(const vec2<type> &offset)
+		{ return affine2(vec2<type>(type(1), type()), vec2<type>(type(), type(1)), offset); }
+	static affine2 scaling(const vec2<type> &scale)
+		{ return affine2(vec2<type>(scale.x, type()), vec2<type>(type(), scale.y), vec2<type>()); }
+	static affine2 rect_to_rect(const rect<type> &from, const rect<type> &to) {
+		vec2<type> s( (to.p1.x - to.p0.x)/(from.p1.x - from.p0.x),
+		              (to.p1.y - to.p0.y)/(from.p1.y - from.p0.y) );
+		return affine2(
+			vec2<type>(s.x, type()),
+			vec2<type>(type(), s.y),
+			vec2<type>(to.p0.x - from.p0.x*s.x, to.p0.y - from.p0.y*s.y) );
+	}
+};
+
 typedef vec2<Real> Vector;
 typedef line2<Real> Line;
 typedef rect<Real> Rect;
+typedef affine2<Real> Affine;
 
 typedef vec2<float> vec2f;
 typedef line2<float> line2f;
 typedef rect<float> rectf;
+typedef affine2<float> affine2f;
 
 typedef vec2<int> vec2i;
 typedef line2<int> line2i;
@@ -31,10 +31,26 @@ using namespace std;
 typedef GLXContext (*GLXCREATECONTEXTATTRIBSARBPROC)(Display*, GLXFBConfig, GLXContext, Bool, const int*);
 
 
-GlContext::GlContext(int width, int height, bool hdr, bool multisample, int samples):
+GlContext *GlContext::current = NULL;
+
+
+// failed context creation raises X error, which terminates program by default handler
+static int ignore_x_error(Display*, XErrorEvent*)
+	{ return 0; }
+
+
+GlContext::GlContext(int width, int height, bool hdr, bool multisample, int samples, Platform platform):
+	width(width),
+	height(height),
+	hdr(hdr),
+	platform(platform),
 	display(),
 	pbuffer(),
 	context(),
+	#ifdef EGL
+	egl_display(EGL_NO_DISPLAY),
+	egl_context(EGL_NO_CONTEXT),
+	#endif
 	texture_id(),
 	framebuffer_id(),
 	renderbuffer_id(),
@@ -49,57 +65,21 @@ GlContext::GlContext(int width, int height, bool hdr, bool multisample, int samp
 	int framebuffer_height = height;
 	int framebuffer_samples = samples;
 
-	// display
-
-	display = XOpenDisplay(NULL);
-	assert(display);
-
-	// config
-
-	int config_attribs[] = {
-		GLX_DOUBLEBUFFER,      False,
-		GLX_RED_SIZE,          8,
-		GLX_GREEN_SIZE,        8,
-		GLX_BLUE_SIZE,         8,
-		GLX_ALPHA_SIZE,        8,
-		GLX_DEPTH_SIZE,        24,
-		GLX_STENCIL_SIZE,      8,
-		GLX_ACCUM_RED_SIZE,    8,
-		GLX_ACCUM_GREEN_SIZE,  8,
-		GLX_ACCUM_BLUE_SIZE,   8,
-		GLX_ACCUM_ALPHA_SIZE,  8,
-		GLX_DRAWABLE_TYPE,     GLX_PBUFFER_BIT,
-		None };
-	int nelements = 0;
-	GLXFBConfig *configs = glXChooseFBConfig(display, 0, config_attribs, &nelements);
-	assert(configs != NULL && nelements > 0);
-	GLXFBConfig config = configs[0];
-	assert(config);
-
-	// pbuffer
-
-	int pbuffer_attribs[] = {
-		GLX_PBUFFER_WIDTH, 256,
-		GLX_PBUFFER_HEIGHT, 256,
-		None };
-	pbuffer = glXCreatePbuffer(display, config, pbuffer_attribs);
-	assert(pbuffer);
-
 	// context
 
-	int context_attribs[] = {
-		GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
-		GLX_CONTEXT_MINOR_VERSION_ARB, 3,
-		None };
-	GLXCREATECONTEXTATTRIBSARBPROC glXCreateContextAttribsARB = (GLXCREATECONTEXTATTRIBSARBPROC) glXGetProcAddress((const GLubyte*)"glXCreateContextAttribsARB");
-	context = glXCreateContextAttribsARB(display, config, NULL, True, context_attribs);
-	assert(context);
+	bool created = false;
+	if (platform != PLATFORM_GLX)
+		created = init_egl();
+	if (!created && platform != PLATFORM_EGL)
+		created = init_glx();
+	assert(created);
 
 	use();
 
 	// frame buffer
 
-	GLenum internal_format = hdr ? GL_RGBA16F : GL_RGBA;
+	// sized format, so texture is also usable as image by compute shaders
+	GLenum internal_format = hdr ? GL_RGBA16F : GL_RGBA8;
 	GLenum color_type = hdr ? GL_FLOAT : GL_UNSIGNED_BYTE;
 
 	glGenTextures(1, &texture_id);
@@ -145,6 +125,138 @@ GlContext::GlContext(int width, int height, bool hdr, bool multisample, int samp
 	check();
 }
 
+bool GlContext::init_glx() {
+	// display
+
+	display = XOpenDisplay(NULL);
+	if (!display) return false;
+
+	// config
+
+	int config_attribs[] = {
+		GLX_DOUBLEBUFFER,      False,
+		GLX_RED_SIZE,          8,
+		GLX_GREEN_SIZE,        8,
+		GLX_BLUE_SIZE,         8,
+		GLX_ALPHA_SIZE,        8,
+		GLX_DEPTH_SIZE,        24,
+		GLX_STENCIL_SIZE,      8,
+		GLX_ACCUM_RED_SIZE,    8,
+		GLX_ACCUM_GREEN_SIZE,  8,
+		GLX_ACCUM_BLUE_SIZE,   8,
+		GLX_ACCUM_ALPHA_SIZE,  8,
+		GLX_DRAWABLE_TYPE,     GLX_PBUFFER_BIT,
+		None };
+	int nelements = 0;
+	GLXFBConfig *configs = glXChooseFBConfig(display, 0, config_attribs, &nelements);
+	assert(configs != NULL && nelements > 0);
+	GLXFBConfig config = configs[0];
+	assert(config);
+
+	// pbuffer
+
+	int pbuffer_attribs[] = {
+		GLX_PBUFFER_WIDTH, 256,
+		GLX_PBUFFER_HEIGHT, 256,
+		None };
+	pbuffer = glXCreatePbuffer(display, config, pbuffer_attribs);
+	assert(pbuffer);
+
+	// context
+
+	// try 4.3 for compute shaders, then 3.3
+	int context_attribs[] = {
+		GLX_CONTEXT_MAJOR_VERSION_ARB, 4,
+		GLX_CONTEXT_MINOR_VERSION_ARB, 3,
+		None };
+	GLXCREATECONTEXTATTRIBSARBPROC glXCreateContextAttribsARB = (GLXCREATECONTEXTATTRIBSARBPROC) glXGetProcAddress((const GLubyte*)"glXCreateContextAttribsARB");
+	int (*prev_handler)(Display*, XErrorEvent*) = XSetErrorHandler(&ignore_x_error);
+	context = glXCreateContextAttribsARB(display, config, NULL, True, context_attribs);
+	XSync(display, False);
+	if (!context) {
+		context_attribs[1] = 3;
+		context_attribs[3] = 3;
+		context = glXCreateContextAttribsARB(display, config, NULL, True, context_attribs);
+		XSync(display, False);
+	}
+	XSetErrorHandler(prev_handler);
+	assert(context);
+
+	this->platform = PLATFORM_GLX;
+	return true;
+}
+
+bool GlContext::init_egl() {
+#ifdef EGL
+	PFNEGLQUERYDEVICESEXTPROC eglQueryDevicesEXT =
+		(PFNEGLQUERYDEVICESEXTPROC)eglGetProcAddress("eglQueryDevicesEXT");
+	PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+	// display, try GPU device first, then Mesa surfaceless platform, then default display
+
+	EGLDisplay displays[3] = { EGL_NO_DISPLAY, EGL_NO_DISPLAY, EGL_NO_DISPLAY };
+	if (eglQueryDevicesEXT && eglGetPlatformDisplayEXT) {
+		EGLDeviceEXT device = NULL;
+		EGLint count = 0;
+		if (eglQueryDevicesEXT(1, &device, &count) && count > 0)
+			displays[0] = eglGetPlatformDisplayEXT(EGL_PLATFORM_DEVICE_EXT, device, NULL);
+	}
+	if (eglGetPlatformDisplayEXT)
+		displays[1] = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	displays[2] = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+	for(int i = 0; i < 3 && egl_display == EGL_NO_DISPLAY; ++i)
+		if (displays[i] != EGL_NO_DISPLAY && eglInitialize(displays[i], NULL, NULL))
+			egl_display = displays[i];
+	if (egl_display == EGL_NO_DISPLAY) return false;
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+		{ eglTerminate(egl_display); egl_display = EGL_NO_DISPLAY; return false; }
+
+	// config, we never draw to surface, so any config is suitable
+
+	EGLint config_attribs[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE };
+	EGLConfig config = NULL;
+	EGLint nelements = 0;
+	if (!eglChooseConfig(egl_display, config_attribs, &config, 1, &nelements) || nelements <= 0)
+		config = NULL; // EGL_NO_CONFIG_KHR
+
+	// context
+
+	// try 4.3 for compute shaders, then 3.3
+	EGLint context_attribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION_KHR, 4,
+		EGL_CONTEXT_MINOR_VERSION_KHR, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK_KHR, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT_KHR,
+		EGL_NONE };
+	egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attribs);
+	if (egl_context == EGL_NO_CONTEXT) {
+		context_attribs[1] = 3;
+		context_attribs[3] = 3;
+		egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attribs);
+	}
+	if (egl_context == EGL_NO_CONTEXT)
+		{ eglTerminate(egl_display); egl_display = EGL_NO_DISPLAY; return false; }
+
+	// surfaceless
+	if (!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) {
+		eglDestroyContext(egl_display, egl_context);
+		eglTerminate(egl_display);
+		egl_context = EGL_NO_CONTEXT;
+		egl_display = EGL_NO_DISPLAY;
+		return false;
+	}
+
+	this->platform = PLATFORM_EGL;
+	return true;
+#else
+	return false;
+#endif
+}
+
 GlContext::~GlContext() {
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
@@ -161,15 +273,37 @@ GlContext::~GlContext() {
 	glDeleteTextures(1, &multisample_texture_id);
 
 	unuse();
+	#ifdef EGL
+	if (platform == PLATFORM_EGL) {
+		eglDestroyContext(egl_display, egl_context);
+		eglTerminate(egl_display);
+		return;
+	}
+	#endif
 	glXDestroyContext(display, context);
 	glXDestroyPbuffer(display, pbuffer);
 	XCloseDisplay(display);
 }
 
-void GlContext::use()
-	{ glXMakeContextCurrent(display, pbuffer, pbuffer, context); }
-void GlContext::unuse()
-	{ glXMakeContextCurrent(display, None, None, NULL); }
+void GlContext::use() {
+	#ifdef EGL
+	if (platform == PLATFORM_EGL)
+		eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context);
+	else
+	#endif
+		glXMakeContextCurrent(display, pbuffer, pbuffer, context);
+	current = this;
+}
+
+void GlContext::unuse() {
+	#ifdef EGL
+	if (platform == PLATFORM_EGL)
+		eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	else
+	#endif
+		glXMakeContextCurrent(display, None, None, NULL);
+	if (current == this) current = NULL;
+}
 
 void GlContext::check(const std::string &s) {
 	if (GLenum error = glGetError())
@@ -24,13 +24,44 @@
 #include <GL/glext.h>
 #include <GL/glx.h>
 
+#ifdef EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
 
+// Offscreen GL context with framebuffer of given size.
+// Context is created by GLX with pbuffer, or headless by EGL without any surface,
+// so X server is not needed. Framebuffer setup is the same for both.
 class GlContext {
 public:
+	enum Platform {
+		PLATFORM_AUTO, // EGL when built with it, GLX when EGL failed
+		PLATFORM_GLX,
+		PLATFORM_EGL
+	};
+
+private:
+	static GlContext *current;
+
+	bool init_glx();
+	bool init_egl();
+
+public:
+	int width;
+	int height;
+	bool hdr;
+	Platform platform;
+
 	Display *display;
 	GLXPbuffer pbuffer;
 	GLXContext context;
 
+	#ifdef EGL
+	EGLDisplay egl_display;
+	EGLContext egl_context;
+	#endif
+
 	GLuint texture_id;
 	GLuint framebuffer_id;
 	GLuint renderbuffer_id;
@@ -39,11 +70,12 @@ public:
 	GLuint multisample_renderbuffer_id;
 	GLuint multisample_framebuffer_id;
 
-	GlContext(int width, int height, bool hdr, bool multisample, int samples);
+	GlContext(int width, int height, bool hdr, bool multisample, int samples, Platform platform = PLATFORM_AUTO);
 	~GlContext();
 
 	void use();
 	void unuse();
+	static GlContext* get_current() { return current; }
 
 	void check(const std::string &s = std::string());
 };
@@ -0,0 +1,112 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+
+#include "glreadback.h"
+#include "utils.h"
+
+
+using namespace std;
+
+
+GlReadback::GlReadback(int count):
+	slots(count),
+	next()
+{
+	assert(count > 0);
+	for(vector<Slot>::iterator i = slots.begin(); i != slots.end(); ++i) {
+		glGenBuffers(1, &i->buffer_id);
+		i->fence = NULL;
+		i->width = 0;
+		i->height = 0;
+	}
+}
+
+GlReadback::~GlReadback() {
+	flush();
+	for(vector<Slot>::iterator i = slots.begin(); i != slots.end(); ++i)
+		glDeleteBuffers(1, &i->buffer_id);
+}
+
+void GlReadback::complete(Slot &slot) {
+	if (!slot.fence) return;
+
+	glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+	glDeleteSync(slot.fence);
+	slot.fence = NULL;
+
+	if (!slot.filename.empty()) {
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer_id);
+		const void *pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, 4*slot.width*slot.height, GL_MAP_READ_BIT);
+		assert(pixels);
+		Utils::save_rgba(pixels, slot.width, slot.height, false, slot.filename);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+}
+
+void GlReadback::read(const std::string &filename) {
+	Slot &slot = slots[next];
+	next = (next + 1)%(int)slots.size();
+
+	// previous content of buffer is needed right now
+	complete(slot);
+
+	GLint vp[4] = {};
+	glGetIntegerv(GL_VIEWPORT, vp);
+
+	// resolve multisample framebuffer
+	GLint draw_buffer = 0, read_buffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_buffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_buffer);
+	if (draw_buffer != read_buffer) {
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)read_buffer);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)draw_buffer);
+		glBlitFramebuffer(vp[0], vp[1], vp[2], vp[3], vp[0], vp[1], vp[2], vp[3], GL_COLOR_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)draw_buffer);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)read_buffer);
+	}
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer_id);
+	if (slot.width != vp[2] || slot.height != vp[3]) {
+		slot.width = vp[2];
+		slot.height = vp[3];
+		glBufferData(GL_PIXEL_PACK_BUFFER, 4*slot.width*slot.height, NULL, GL_STREAM_READ);
+	}
+	glReadPixels(vp[0], vp[1], vp[2], vp[3], GL_BGRA, GL_UNSIGNED_BYTE, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.filename = filename;
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+}
+
+void GlReadback::poll() {
+	// complete in order of reading
+	for(int i = 0; i < (int)slots.size(); ++i) {
+		Slot &slot = slots[(next + i)%(int)slots.size()];
+		if (!slot.fence) continue;
+		if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED) break;
+		complete(slot);
+	}
+}
+
+void GlReadback::flush() {
+	for(int i = 0; i < (int)slots.size(); ++i)
+		complete(slots[(next + i)%(int)slots.size()]);
+}
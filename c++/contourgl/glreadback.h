@@ -0,0 +1,60 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GLREADBACK_H_
+#define _GLREADBACK_H_
+
+#include <string>
+#include <vector>
+
+#include "glcontext.h"
+
+
+// Asynchronous readback of viewport by ring of pixel buffer objects.
+// Pixels of frame are copied into buffer by GPU while the next frames are rendering,
+// buffer is mapped only when its fence is signaled or when buffer is needed again.
+class GlReadback {
+private:
+	struct Slot {
+		GLuint buffer_id;
+		GLsync fence;
+		int width;
+		int height;
+		std::string filename;
+	};
+
+	std::vector<Slot> slots;
+	int next;
+
+	void complete(Slot &slot);
+
+public:
+	explicit GlReadback(int count = 3);
+	~GlReadback();
+
+	// queue reading of current viewport, pixels will be saved into tga file,
+	// empty filename means that pixels are just read
+	void read(const std::string &filename);
+
+	// complete reads which are already done by GPU, don't wait
+	void poll();
+
+	// wait and complete all queued reads
+	void flush();
+};
+
+#endif
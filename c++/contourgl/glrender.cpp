@@ -0,0 +1,363 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+
+#include <algorithm>
+
+#include "glrender.h"
+#include "utils.h"
+
+
+using namespace std;
+
+
+GlRender::GlRender(Shaders &shaders):
+	shaders(shaders),
+	stencil_buffer_id(),
+	stencil_array_id(),
+	cover_buffer_id(),
+	cover_array_id(),
+	triangles_buffer_id(),
+	triangles_array_id()
+{ }
+
+GlRender::~GlRender() {
+	remove_paths();
+}
+
+void GlRender::remove_paths() {
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// zero names are silently ignored
+	glDeleteVertexArrays(1, &stencil_array_id);
+	glDeleteVertexArrays(1, &cover_array_id);
+	glDeleteVertexArrays(1, &triangles_array_id);
+	glDeleteBuffers(1, &stencil_buffer_id);
+	glDeleteBuffers(1, &cover_buffer_id);
+	glDeleteBuffers(1, &triangles_buffer_id);
+	stencil_array_id = 0;
+	cover_array_id = 0;
+	triangles_array_id = 0;
+	stencil_buffer_id = 0;
+	cover_buffer_id = 0;
+	triangles_buffer_id = 0;
+
+	starts.clear();
+	counts.clear();
+	batches.clear();
+}
+
+void GlRender::send_paths(const Path *paths, int count, bool triangulate) {
+	remove_paths();
+
+	vector<vec2f> vertices;
+	vector<Vertex> cover;
+	vector<Vertex> triangles;
+	vector<const Path*> used;
+	vector<recti> bounds;
+	vector< pair<int, int> > triangle_ranges;
+	recti total;
+
+	// fans for stencil and rectangles of bounds for cover,
+	// or triangles when contour is triangulated
+	for(const Path *i = paths, *end = paths + count; i < end; ++i) {
+		const Contour::ChunkList &chunks = i->contour->get_lod().get_chunks();
+		if (chunks.empty()) continue;
+
+		const vector<Vector> *contour_triangles =
+			triangulate && !i->invert ? i->contour->get_lod().get_triangles(i->evenodd) : NULL;
+		if (contour_triangles) {
+			Vertex v;
+			v.color = i->color;
+			int first = (int)triangles.size();
+			for(vector<Vector>::const_iterator j = contour_triangles->begin(); j != contour_triangles->end(); j += 3) {
+				// skip triangles degenerated by conversion to float
+				vec2f a(j[0]), b(j[1]), c(j[2]);
+				vec2f ab = b - a, ac = c - a;
+				if (ab.x*ac.y == ab.y*ac.x) continue;
+				v.position = a; triangles.push_back(v);
+				v.position = b; triangles.push_back(v);
+				v.position = c; triangles.push_back(v);
+			}
+			triangle_ranges.push_back(make_pair(first, (int)triangles.size()));
+			bounds.push_back(recti());
+			used.push_back(i);
+			continue;
+		}
+
+		starts.push_back((GLint)vertices.size());
+		Rect r(chunks.front().p1, chunks.front().p1);
+		for(Contour::ChunkList::const_iterator j = chunks.begin(); j != chunks.end(); ++j) {
+			vertices.push_back(vec2f(j->p1));
+			r = r.expand(j->p1);
+		}
+		counts.push_back((GLsizei)vertices.size() - starts.back());
+
+		recti b( (int)floor(r.p0.x), (int)floor(r.p0.y),
+				 (int)ceil(r.p1.x) + 1, (int)ceil(r.p1.y) + 1 );
+		if (starts.size() == 1) {
+			total = b;
+		} else {
+			total.p0.x = min(total.p0.x, b.p0.x);
+			total.p0.y = min(total.p0.y, b.p0.y);
+			total.p1.x = max(total.p1.x, b.p1.x);
+			total.p1.y = max(total.p1.y, b.p1.y);
+		}
+		triangle_ranges.push_back(make_pair(-1, -1));
+		bounds.push_back(b);
+		used.push_back(i);
+
+		Vertex v;
+		v.color = i->color;
+		v.position = vec2f((float)b.p0.x, (float)b.p0.y); cover.push_back(v);
+		v.position = vec2f((float)b.p1.x, (float)b.p0.y); cover.push_back(v);
+		v.position = vec2f((float)b.p0.x, (float)b.p1.y); cover.push_back(v);
+		v.position = vec2f((float)b.p0.x, (float)b.p1.y); cover.push_back(v);
+		v.position = vec2f((float)b.p1.x, (float)b.p0.y); cover.push_back(v);
+		v.position = vec2f((float)b.p1.x, (float)b.p1.y); cover.push_back(v);
+	}
+	if (used.empty()) return;
+
+	// split sequence of contours to batches,
+	// overlapping is checked roughly by grid of cells marked by index of last batch
+	const int cell_size = 16;
+	int grid_width = starts.empty() ? 0 : (total.p1.x - total.p0.x)/cell_size + 1;
+	int grid_height = starts.empty() ? 0 : (total.p1.y - total.p0.y)/cell_size + 1;
+	vector<int> grid(grid_width*grid_height, -1);
+	int stencil_index = 0;
+	for(int i = 0; i < (int)used.size(); ++i) {
+		if (triangle_ranges[i].first >= 0) {
+			// triangles are drawn in order, so overlapping is allowed
+			if (batches.empty() || !batches.back().triangles) {
+				Batch batch = { triangle_ranges[i].first, triangle_ranges[i].first, false, false, true };
+				batches.push_back(batch);
+			}
+			batches.back().end = triangle_ranges[i].second;
+			continue;
+		}
+
+		int x0 = (bounds[i].p0.x - total.p0.x)/cell_size;
+		int y0 = (bounds[i].p0.y - total.p0.y)/cell_size;
+		int x1 = (bounds[i].p1.x - 1 - total.p0.x)/cell_size + 1;
+		int y1 = (bounds[i].p1.y - 1 - total.p0.y)/cell_size + 1;
+
+		int index = (int)batches.size() - 1;
+		bool fits = !batches.empty()
+				 && !batches.back().triangles
+				 && batches.back().invert == used[i]->invert
+				 && batches.back().evenodd == used[i]->evenodd;
+		for(int y = y0; fits && y < y1; ++y)
+			for(int x = x0; x < x1; ++x)
+				if (grid[y*grid_width + x] == index)
+					{ fits = false; break; }
+
+		if (!fits) {
+			Batch batch = { stencil_index, stencil_index, used[i]->invert, used[i]->evenodd, false };
+			batches.push_back(batch);
+			++index;
+		}
+		batches.back().end = ++stencil_index;
+
+		for(int y = y0; y < y1; ++y)
+			for(int x = x0; x < x1; ++x)
+				grid[y*grid_width + x] = index;
+	}
+
+	// buffers
+
+	if (!vertices.empty()) {
+		glGenBuffers(1, &stencil_buffer_id);
+		glBindBuffer(GL_ARRAY_BUFFER, stencil_buffer_id);
+		glBufferData( GL_ARRAY_BUFFER,
+					  vertices.size()*sizeof(vertices.front()),
+					  &vertices.front(),
+					  GL_STATIC_DRAW );
+
+		glGenVertexArrays(1, &stencil_array_id);
+		glBindVertexArray(stencil_array_id);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vertices.front()), NULL);
+
+		glGenBuffers(1, &cover_buffer_id);
+		glBindBuffer(GL_ARRAY_BUFFER, cover_buffer_id);
+		glBufferData( GL_ARRAY_BUFFER,
+					  cover.size()*sizeof(cover.front()),
+					  &cover.front(),
+					  GL_STATIC_DRAW );
+
+		glGenVertexArrays(1, &cover_array_id);
+		glBindVertexArray(cover_array_id);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), NULL);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)sizeof(vec2f));
+	}
+
+	if (!triangles.empty()) {
+		glGenBuffers(1, &triangles_buffer_id);
+		glBindBuffer(GL_ARRAY_BUFFER, triangles_buffer_id);
+		glBufferData( GL_ARRAY_BUFFER,
+					  triangles.size()*sizeof(triangles.front()),
+					  &triangles.front(),
+					  GL_STATIC_DRAW );
+
+		glGenVertexArrays(1, &triangles_array_id);
+		glBindVertexArray(triangles_array_id);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), NULL);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)sizeof(vec2f));
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GlRender::draw() {
+	if (batches.empty()) return;
+
+	shaders.attrib(vec2f(Utils::get_frame_size()));
+	glEnable(GL_STENCIL_TEST);
+	glClear(GL_STENCIL_BUFFER_BIT);
+
+	for(vector<Batch>::const_iterator i = batches.begin(); i != batches.end(); ++i) {
+		if (i->triangles) {
+			// stencil is zero here, so just pass stencil test
+			glStencilFunc(GL_ALWAYS, 0, 0);
+			glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+			glBindVertexArray(triangles_array_id);
+			glDrawArrays(GL_TRIANGLES, i->begin, i->end - i->begin);
+			continue;
+		}
+
+		// render mask
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glStencilFunc(GL_ALWAYS, 0, 0);
+		if (i->evenodd) {
+			glStencilOp(GL_INCR_WRAP, GL_INCR_WRAP, GL_INCR_WRAP);
+		} else {
+			glStencilOpSeparate(GL_FRONT, GL_INCR_WRAP, GL_INCR_WRAP, GL_INCR_WRAP);
+			glStencilOpSeparate(GL_BACK, GL_DECR_WRAP, GL_DECR_WRAP, GL_DECR_WRAP);
+		}
+		glBindVertexArray(stencil_array_id);
+		glMultiDrawArrays(GL_TRIANGLE_FAN, &starts[i->begin], &counts[i->begin], i->end - i->begin);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+		// fill mask, bounds of batch are not overlapped, so clear stencil here
+		glStencilOp(GL_ZERO, GL_ZERO, GL_ZERO);
+		if (!i->evenodd && !i->invert)
+			glStencilFunc(GL_NOTEQUAL, 0, -1);
+		if (!i->evenodd &&  i->invert)
+			glStencilFunc(GL_EQUAL, 0, -1);
+		if ( i->evenodd && !i->invert)
+			glStencilFunc(GL_EQUAL, 1, 1);
+		if ( i->evenodd &&  i->invert)
+			glStencilFunc(GL_EQUAL, 0, 1);
+		glBindVertexArray(cover_array_id);
+		glDrawArrays(GL_TRIANGLES, 6*i->begin, 6*(i->end - i->begin));
+	}
+
+	glBindVertexArray(0);
+	glDisable(GL_STENCIL_TEST);
+}
+
+
+GlComputeRender::GlComputeRender(GlContext &gl, Shaders &shaders):
+	gl(gl),
+	shaders(shaders),
+	marks_buffer_id(),
+	points_buffer_id()
+{
+	assert(shaders.compute_supported);
+
+	// pair of integers per pixel, filled by zeros
+	glGenBuffers(1, &marks_buffer_id);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, marks_buffer_id);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, gl.width*gl.height*sizeof(vec2i), NULL, GL_DYNAMIC_COPY);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_RG32I, GL_RG_INTEGER, GL_INT, NULL);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+GlComputeRender::~GlComputeRender() {
+	send_points(NULL, 0);
+	glDeleteBuffers(1, &marks_buffer_id);
+}
+
+void GlComputeRender::send_points(const vec2f *points, int count) {
+	if (points_buffer_id) {
+		glDeleteBuffers(1, &points_buffer_id);
+		points_buffer_id = 0;
+	}
+
+	if (points && count > 0) {
+		glGenBuffers(1, &points_buffer_id);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, points_buffer_id);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, count*sizeof(vec2f), points, GL_STATIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+}
+
+void GlComputeRender::draw(const Path &path) {
+	assert(points_buffer_id);
+
+	recti path_bounds = path.bounds;
+	if (!transform.is_identity()) {
+		rectf r = transform.transform_bounds(rectf(
+			(float)path.bounds.p0.x, (float)path.bounds.p0.y,
+			(float)path.bounds.p1.x, (float)path.bounds.p1.y ));
+		path_bounds = recti(
+			(int)floor(r.p0.x), (int)floor(r.p0.y),
+			(int)ceil(r.p1.x), (int)ceil(r.p1.y) );
+	}
+
+	// fill also resets marks, so take one more pixel around to catch rounding errors,
+	// inverted path covers whole frame
+	recti bounds(0, 0, gl.width, gl.height);
+	if (!path.invert) {
+		bounds.p0.x = max(bounds.p0.x, path_bounds.p0.x - 1);
+		bounds.p0.y = max(bounds.p0.y, path_bounds.p0.y - 1);
+		bounds.p1.x = min(bounds.p1.x, path_bounds.p1.x + 1);
+		bounds.p1.y = min(bounds.p1.y, path_bounds.p1.y + 1);
+	}
+	if ( bounds.p0.x >= bounds.p1.x
+	  || bounds.p0.y >= bounds.p1.y ) return;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, marks_buffer_id);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, points_buffer_id);
+	glBindImageTexture(0, gl.texture_id, 0, GL_FALSE, 0, GL_READ_WRITE, gl.hdr ? GL_RGBA16F : GL_RGBA8);
+
+	if (path.begin < path.end) {
+		shaders.compute_path(vec2i(gl.width, gl.height), path.begin, path.end, transform);
+		glDispatchCompute((path.end - path.begin - 1)/path_group_size + 1, 1, 1);
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+	shaders.compute_fill(gl.hdr, gl.width, bounds, path.color, path.evenodd, path.invert);
+	glDispatchCompute((bounds.p1.x - bounds.p0.x - 1)/fill_group_size + 1, 1, 1);
+	glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+}
+
+void GlComputeRender::flush() {
+	glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+}
+
+void GlComputeRender::wait() {
+	flush();
+	glFinish();
+}
@@ -0,0 +1,127 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _GLRENDER_H_
+#define _GLRENDER_H_
+
+#include <vector>
+
+#include "contour.h"
+#include "glcontext.h"
+#include "shaders.h"
+#include "swrender.h"
+
+
+// Stencil renderer which draws contours by batches.
+// Batch is a sequence of contours with same fill rules and non-overlapping bounds,
+// so stencil of whole batch is built by single glMultiDrawArrays call
+// and colored by single glDrawArrays call, which also resets stencil back to zero.
+// Optionally contours are triangulated (see Contour::get_triangles), sequence of such
+// contours is drawn as plain triangles by single call without stencil.
+class GlRender {
+public:
+	typedef ContourPath Path;
+
+private:
+	struct Vertex {
+		vec2f position;
+		Color color;
+	};
+
+	// range of paths for stencil batch or range of vertices for triangles batch
+	struct Batch {
+		int begin;
+		int end;
+		bool invert;
+		bool evenodd;
+		bool triangles;
+	};
+
+	Shaders &shaders;
+
+	GLuint stencil_buffer_id;
+	GLuint stencil_array_id;
+	GLuint cover_buffer_id;
+	GLuint cover_array_id;
+	GLuint triangles_buffer_id;
+	GLuint triangles_array_id;
+
+	std::vector<GLint> starts;
+	std::vector<GLsizei> counts;
+	std::vector<Batch> batches;
+
+	void remove_paths();
+
+public:
+	explicit GlRender(Shaders &shaders);
+	~GlRender();
+
+	// coordinates of contours are in pixels,
+	// inverted contours and contours with self-intersections are never triangulated
+	void send_paths(const Path *paths, int count, bool triangulate = false);
+
+	// draw into current framebuffer
+	void draw();
+
+	int get_batches_count() const { return (int)batches.size(); }
+};
+
+
+// Analytic antialiased renderer by GL 4.3 compute shaders, port of ClRender3.
+// Draws directly into texture of GlContext, so no multisampling and no copying needed.
+class GlComputeRender {
+public:
+	struct Path {
+		recti bounds;
+		int begin;
+		int end;
+		Color color;
+		bool invert;
+		bool evenodd;
+	};
+
+	static const int path_group_size = 64;
+	static const int fill_group_size = 16;
+
+private:
+	GlContext &gl;
+	Shaders &shaders;
+
+	GLuint marks_buffer_id;
+	GLuint points_buffer_id;
+	affine2f transform;
+
+public:
+	GlComputeRender(GlContext &gl, Shaders &shaders);
+	~GlComputeRender();
+
+	// points of path from begin to end, and then the first point again
+	void send_points(const vec2f *points, int count);
+
+	// matrix applied to sent points by shader for the following draw calls
+	void set_transform(const affine2f &transform) { this->transform = transform; }
+	const affine2f& get_transform() const { return transform; }
+
+	void draw(const Path &path);
+
+	// make drawn pixels visible for the following framebuffer operations
+	void flush();
+	// flush and wait for GPU
+	void wait();
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+#include <cstring>
+
+#include <algorithm>
+
+#include "hybridrender.h"
+#include "measure.h"
+
+
+using namespace std;
+
+
+void HybridRender::DrawTask::run(int thread_index, int) {
+	// first thread serves OpenCL and helps to CPU threads when OpenCL done
+	if (thread_index == 0)
+		owner.draw_cl();
+	owner.draw_sw(owner.polyspans[thread_index]);
+}
+
+
+HybridRender::HybridRender(ClContext &cl, ThreadPool &pool):
+	clr(cl),
+	pool(pool),
+	surface(),
+	cl_surface(),
+	polyspans(pool.count()),
+	split(),
+	split_smooth(),
+	start_time(),
+	cl_time(),
+	sw_time(),
+	next_row()
+{ }
+
+HybridRender::~HybridRender() {
+	clr.send_points(NULL, 0);
+	clr.send_surface(NULL);
+	delete cl_surface;
+}
+
+void HybridRender::send_surface(Surface *surface) {
+	// keep balanced split row for surfaces of the same height
+	bool reset = !surface || !this->surface || this->surface->height != surface->height;
+	this->surface = surface;
+	if (reset) {
+		split = 0;
+		split_smooth = 0.0;
+		if (surface) {
+			// start from half of frame, when both parts available
+			int bands = surface->height/band_height;
+			split = bands > 1 ? bands/2*band_height : 0;
+			split_smooth = split;
+		}
+	}
+}
+
+void HybridRender::send_paths(const Path *paths, int count) {
+	int align = (1024 - 1)/sizeof(vec2f) + 1;
+
+	this->paths.assign(paths, paths + count);
+	bounds.resize(count);
+	for(int i = 0; i < count; ++i)
+		bounds[i] = paths[i].contour->get_lod().get_bounds();
+	cl_paths.clear();
+	points.clear();
+	for(const Path *i = paths, *end = paths + count; i < end; ++i) {
+		const Contour::ChunkList &chunks = i->contour->get_lod().get_chunks();
+
+		// keep indices equal to indices of paths, so also add empty paths
+		ClRender3::Path path = {};
+		path.color = i->color;
+		path.invert = i->invert;
+		path.evenodd = i->evenodd;
+		path.begin = path.end = (int)points.size();
+
+		if (!chunks.empty()) {
+			path.bounds.minx = path.bounds.maxx = (int)floor(chunks.front().p1.x);
+			path.bounds.miny = path.bounds.maxy = (int)floor(chunks.front().p1.y);
+			points.reserve(points.size() + chunks.size() + 1);
+			for(Contour::ChunkList::const_iterator j = chunks.begin(); j != chunks.end(); ++j) {
+				int x = (int)floor(j->p1.x);
+				int y = (int)floor(j->p1.y);
+				if (path.bounds.minx > x) path.bounds.minx = x;
+				if (path.bounds.maxx < x) path.bounds.maxx = x;
+				if (path.bounds.miny > y) path.bounds.miny = y;
+				if (path.bounds.maxy < y) path.bounds.maxy = y;
+				points.push_back(vec2f(j->p1));
+			}
+			path.end = (int)points.size();
+			do { points.push_back( points[path.begin] ); } while(points.size() % align);
+			++path.bounds.maxx;
+			++path.bounds.maxy;
+		}
+
+		cl_paths.push_back(path);
+	}
+
+	clr.send_points(points.empty() ? NULL : &points.front(), (int)points.size());
+}
+
+void HybridRender::draw_cl() {
+	if (split > 0) {
+		// top rows of frame are continuous part of surface data
+		if (!cl_surface || cl_surface->width != surface->width || cl_surface->height != split) {
+			clr.send_surface(NULL);
+			delete cl_surface;
+			cl_surface = new Surface(surface->width, split);
+		}
+		memcpy(cl_surface->data, surface->data, cl_surface->data_size());
+
+		clr.send_surface(cl_surface);
+		for(vector<ClRender3::Path>::const_iterator i = cl_paths.begin(); i != cl_paths.end(); ++i)
+			clr.draw(*i);
+		clr.receive_surface();
+
+		memcpy(surface->data, cl_surface->data, cl_surface->data_size());
+	}
+	cl_time = Measure::get_time() - start_time;
+}
+
+void HybridRender::draw_sw(Polyspan &polyspan) {
+	bool any = false;
+	while(true) {
+		int y0 = next_row.fetch_add(band_height);
+		if (y0 >= surface->height) break;
+		int y1 = min(y0 + band_height, surface->height);
+		any = true;
+
+		for(int i = 0; i < (int)paths.size(); ++i) {
+			const Path &path = paths[i];
+			// contours outside of band are skipped, inverted ones fill whole band
+			if ( !path.invert
+			  && (bounds[i].p1.y < (Real)y0 || bounds[i].p0.y > (Real)y1) ) continue;
+
+			polyspan.init(0, y0, surface->width, y1);
+			path.contour->to_polyspan(polyspan);
+			polyspan.sort_marks();
+			SwRender::polyspan(*surface, polyspan, path.color, path.evenodd, path.invert);
+		}
+	}
+
+	if (any) {
+		long long t = Measure::get_time() - start_time;
+		long long prev = sw_time;
+		while(prev < t && !sw_time.compare_exchange_weak(prev, t)) { }
+	}
+}
+
+void HybridRender::draw() {
+	assert(surface);
+
+	start_time = Measure::get_time();
+	cl_time = 0;
+	sw_time = 0;
+	next_row = split;
+
+	DrawTask task(*this);
+	pool.run(task);
+
+	// move split row to the point where both parts should finish at the same time
+	int height = surface->height;
+	if (split > 0 && split < height && cl_time > 0 && sw_time > 0) {
+		Real cl_speed = (Real)split/(Real)cl_time;
+		Real sw_speed = (Real)(height - split)/(Real)sw_time;
+		Real target = (Real)height*cl_speed/(cl_speed + sw_speed);
+		split_smooth = 0.5*(split_smooth + target);
+
+		// keep at least one band for each part to continue measurement
+		int bands = height/band_height;
+		int split_bands = (int)round(split_smooth/band_height);
+		split_bands = max(1, min(bands - 1, split_bands));
+		split = split_bands*band_height;
+	}
+}
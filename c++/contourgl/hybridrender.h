@@ -0,0 +1,85 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _HYBRIDRENDER_H_
+#define _HYBRIDRENDER_H_
+
+#include <vector>
+#include <atomic>
+
+#include "clrender.h"
+#include "contour.h"
+#include "polyspan.h"
+#include "swrender.h"
+#include "threadpool.h"
+
+
+// Renders top rows of frame by OpenCL and the rest rows by CPU threads at the same time.
+// The split row moves after every frame to equalize measured times of both parts.
+class HybridRender {
+public:
+	typedef ContourPath Path;
+
+	// rows are distributed between CPU threads by bands of this height,
+	// split row is also aligned to it
+	static const int band_height = 16;
+
+private:
+	class DrawTask: public ThreadPool::Task {
+	private:
+		HybridRender &owner;
+	public:
+		explicit DrawTask(HybridRender &owner): owner(owner) { }
+		virtual void run(int thread_index, int thread_count);
+	};
+
+	ClRender3 clr;
+	ThreadPool &pool;
+
+	Surface *surface;
+	Surface *cl_surface;
+
+	std::vector<Path> paths;
+	std::vector<Rect> bounds;
+	std::vector<ClRender3::Path> cl_paths;
+	std::vector<vec2f> points;
+	std::vector<Polyspan> polyspans;
+
+	int split;
+	Real split_smooth;
+	long long start_time;
+	long long cl_time;
+	std::atomic<long long> sw_time;
+	std::atomic<int> next_row;
+
+	void draw_cl();
+	void draw_sw(Polyspan &polyspan);
+
+public:
+	HybridRender(ClContext &cl, ThreadPool &pool);
+	~HybridRender();
+
+	void send_surface(Surface *surface);
+	void send_paths(const Path *paths, int count);
+
+	// draw frame synchronously and adapt split row for the next frame
+	void draw();
+
+	int get_split() const { return split; }
+};
+
+#endif
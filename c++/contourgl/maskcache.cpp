@@ -0,0 +1,49 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "maskcache.h"
+
+
+using namespace std;
+
+
+bool MaskCache::Key::operator< (const Key &other) const {
+	if (geometry != other.geometry) return geometry < other.geometry;
+	if (subpixel_x != other.subpixel_x) return subpixel_x < other.subpixel_x;
+	if (subpixel_y != other.subpixel_y) return subpixel_y < other.subpixel_y;
+	if (axis_x.x != other.axis_x.x) return axis_x.x < other.axis_x.x;
+	if (axis_x.y != other.axis_x.y) return axis_x.y < other.axis_x.y;
+	if (axis_y.x != other.axis_y.x) return axis_y.x < other.axis_y.x;
+	return axis_y.y < other.axis_y.y;
+}
+
+void MaskCache::clear() {
+	masks.clear();
+	used.clear();
+	memory = 0;
+}
+
+void MaskCache::remove_unused() {
+	// last added mask is never removed
+	while(memory > max_memory && used.size() > 1) {
+		MaskMap::iterator i = masks.find(used.back());
+		memory -= i->second.size;
+		masks.erase(i);
+		used.pop_back();
+	}
+}
@@ -0,0 +1,128 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _MASKCACHE_H_
+#define _MASKCACHE_H_
+
+#include <list>
+#include <map>
+#include <memory>
+
+#include "geometry.h"
+#include "contour.h"
+#include "polyspan.h"
+
+
+// Sorted polyspans of transformed contours which are reused while contour is only translated,
+// like glyph cache. Key is geometry of contour, linear part of transformation and
+// subpixel part of translation rounded to 1/subpixel_steps of pixel, whole pixels are applied
+// by moving of cached polyspan. Least recently used masks are removed when memory limit is reached.
+// Geometry is held by cache, so contour copies it before editing and edited contour gets new key.
+class MaskCache {
+public:
+	typedef std::shared_ptr<const Contour::ChunkList> GeometryPtr;
+
+private:
+	struct Key {
+		const Contour::ChunkList *geometry;
+		vec2f axis_x, axis_y;
+		int subpixel_x, subpixel_y;
+		bool operator< (const Key &other) const;
+	};
+
+	struct Mask {
+		GeometryPtr geometry;
+		Polyspan polyspan;
+		int x, y;
+		size_t size;
+		std::list<Key>::iterator used;
+	};
+
+	typedef std::map<Key, Mask> MaskMap;
+
+	size_t max_memory;
+	int subpixel_steps;
+	size_t memory;
+	MaskMap masks;
+	// most recently used keys first
+	std::list<Key> used;
+	int hits;
+	int misses;
+
+	void remove_unused();
+
+public:
+	explicit MaskCache(size_t max_memory = 64 << 20, int subpixel_steps = 4):
+		max_memory(max_memory), subpixel_steps(subpixel_steps), memory(), hits(), misses() { }
+
+	void clear();
+
+	// polyspan of geometry transformed by matrix with translation rounded to subpixel grid,
+	// build(Polyspan&, const affine2f&) is called for missing mask, it should fill polyspan
+	// with window which covers whole geometry and sort marks.
+	// Returned polyspan is valid until next call.
+	template<typename T>
+	const Polyspan& get(const GeometryPtr &geometry, const affine2f &transform, T &build) {
+		Key key = {};
+		key.geometry = geometry.get();
+		key.axis_x = transform.axis_x;
+		key.axis_y = transform.axis_y;
+		int x = (int)floorf(transform.offset.x);
+		int y = (int)floorf(transform.offset.y);
+		key.subpixel_x = (int)floorf((transform.offset.x - (float)x)*(float)subpixel_steps + 0.5f);
+		key.subpixel_y = (int)floorf((transform.offset.y - (float)y)*(float)subpixel_steps + 0.5f);
+		if (key.subpixel_x == subpixel_steps) { key.subpixel_x = 0; ++x; }
+		if (key.subpixel_y == subpixel_steps) { key.subpixel_y = 0; ++y; }
+
+		MaskMap::iterator i = masks.find(key);
+		if (i != masks.end()) {
+			++hits;
+			Mask &mask = i->second;
+			used.splice(used.begin(), used, mask.used);
+			mask.polyspan.translate(x - mask.x, y - mask.y);
+			mask.x = x;
+			mask.y = y;
+			return mask.polyspan;
+		}
+
+		++misses;
+		affine2f snapped = transform;
+		snapped.offset = vec2f(
+			(float)x + (float)key.subpixel_x/(float)subpixel_steps,
+			(float)y + (float)key.subpixel_y/(float)subpixel_steps );
+
+		Mask &mask = masks[key];
+		mask.geometry = geometry;
+		mask.x = x;
+		mask.y = y;
+		build(mask.polyspan, snapped);
+		mask.polyspan.shrink();
+		mask.size = sizeof(Mask) + mask.polyspan.get_covers().capacity()*sizeof(Polyspan::PenMark);
+		mask.used = used.insert(used.begin(), key);
+		memory += mask.size;
+		remove_unused();
+		return mask.polyspan;
+	}
+
+	size_t get_memory_size() const { return memory; }
+	int get_count() const { return (int)masks.size(); }
+	int get_hits() const { return hits; }
+	int get_misses() const { return misses; }
+};
+
+#endif
@@ -35,6 +35,8 @@ void Measure::init() {
 	hide = !stack.empty() && stack.back()->hide_subs;
 	hide_subs |= hide;
 	tga = filename.size() > 4 && filename.substr(filename.size()-4, 4) == ".tga";
+	gpu |= tga && !surface;
+	gpu &= GlContext::get_current() != NULL;
 	if (!hide)
 		cout << string(stack.size()*2, ' ')
 		     << "begin             "
@@ -42,14 +44,23 @@ void Measure::init() {
 			 << endl << flush;
 	stack.push_back(this);
 
+	if (gpu) {
+		// timestamps instead of GL_TIME_ELAPSED, because measures may be nested
+		glGenQueries(2, queries);
+		glQueryCounter(queries[0], GL_TIMESTAMP);
+		glFlush();
+	}
+
+	t = get_time();
+}
+
+long long Measure::get_time() {
 	timespec spec;
-	clock_gettime(CLOCK_MONOTONIC , &spec);
-	t = spec.tv_sec*1000000000 + spec.tv_nsec;
+	clock_gettime(CLOCK_MONOTONIC, &spec);
+	return spec.tv_sec*1000000000ll + spec.tv_nsec;
 }
 
 Measure::~Measure() {
-	if (!surface && tga) glFinish();
-
 	long long dt;
 	if (has_subs) {
 		dt = subs;
@@ -67,10 +78,16 @@ Measure::~Measure() {
 			for(vector<long long>::iterator j = repeats.begin(); j != repeats.end(); ++j) sum += *j;
 			dt += sum/repeats.size();
 		}
+	} else
+	if (gpu) {
+		// waits for the end of measured commands only
+		GLint64 t0 = 0, t1 = 0;
+		glQueryCounter(queries[1], GL_TIMESTAMP);
+		glGetQueryObjecti64v(queries[0], GL_QUERY_RESULT, &t0);
+		glGetQueryObjecti64v(queries[1], GL_QUERY_RESULT, &t1);
+		dt = t1 - t0;
 	} else {
-		timespec spec;
-		clock_gettime(CLOCK_MONOTONIC , &spec);
-		dt = spec.tv_sec*1000000000 + spec.tv_nsec - t;
+		dt = get_time() - t;
 	}
 	Real ms = 1000.0*1e-9*(Real)dt;
 
@@ -88,12 +105,14 @@ Measure::~Measure() {
 			Utils::save_viewport(filename);
 	}
 
+	if (gpu)
+		glDeleteQueries(2, queries);
+
 	if (surface) {
 		surface->clear();
 	} else
 	if (tga) {
 		glClear(GL_COLOR_BUFFER_BIT);
-		glFinish();
 	}
 
 	stack.pop_back();
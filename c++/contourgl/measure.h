@@ -34,25 +34,32 @@ private:
 	bool hide;
 	bool hide_subs;
 	bool repeat;
+	bool gpu;
+	unsigned int queries[2];
 
 	bool has_subs;
 	long long subs;
 	long long t;
 	std::vector<long long> repeats;
 
-	Measure(const Measure&): surface(), tga(), hide(), hide_subs(), repeat(), has_subs(), subs(), t() { }
+	Measure(const Measure&): surface(), tga(), hide(), hide_subs(), repeat(), gpu(), queries(), has_subs(), subs(), t() { }
 	Measure& operator= (const Measure&) { return *this; }
 	void init();
 public:
-	Measure(const std::string &filename, bool hide_subs = false, bool repeat = false):
-		filename(filename), surface(), tga(), hide(), hide_subs(hide_subs), repeat(repeat), has_subs(), subs(), t()
+	// gpu means that time of GL commands is measured by timer queries,
+	// it's always so for tga without surface, but only when GL context is current
+	Measure(const std::string &filename, bool hide_subs = false, bool repeat = false, bool gpu = false):
+		filename(filename), surface(), tga(), hide(), hide_subs(hide_subs), repeat(repeat), gpu(gpu), queries(), has_subs(), subs(), t()
 	{ init(); }
 
 	Measure(const std::string &filename, Surface &surface, bool hide_subs = false, bool repeat = false):
-		filename(filename), surface(&surface), tga(), hide(), hide_subs(hide_subs), repeat(repeat), has_subs(), subs(), t()
+		filename(filename), surface(&surface), tga(), hide(), hide_subs(hide_subs), repeat(repeat), gpu(), queries(), has_subs(), subs(), t()
 	{ init(); }
 
 	~Measure();
+
+	// monotonic time in nanoseconds
+	static long long get_time();
 };
 
 #endif
@@ -0,0 +1,128 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cassert>
+
+#include <algorithm>
+
+#include "occlusion.h"
+
+
+using namespace std;
+
+
+void Occlusion::Add::operator() (int x, int y, int length, Real alpha) {
+	if (alpha < 1.0) return;
+	int *pixel = &occlusion.pixels[y*occlusion.width + x];
+	Tile *tiles = &occlusion.tiles[(y/tile_size)*occlusion.tiles_width];
+	for(int i = x, end = x + length; i < end; ++i, ++pixel) {
+		if (*pixel < 0) {
+			// polyspans are added from top to bottom, so first index is topmost
+			*pixel = index;
+			Tile &tile = tiles[i/tile_size];
+			if (--tile.count == 0) tile.index = index;
+		}
+	}
+}
+
+void Occlusion::Draw::operator() (int x, int y, int length, Real alpha) {
+	// draw runs of pixels which are not covered above
+	const int *pixel = &occlusion.pixels[y*occlusion.width + x];
+	for(int i = 0; i < length; ) {
+		while(i < length && pixel[i] > index) ++i;
+		int begin = i;
+		while(i < length && pixel[i] <= index) ++i;
+		if (begin < i) {
+			if (alpha == 1.0)
+				SwRender::row(target, color, x + begin, y, i - begin);
+			else
+				SwRender::row_alpha(target, color, (Color::type)alpha, x + begin, y, i - begin);
+		}
+	}
+}
+
+void Occlusion::init(int width, int height) {
+	this->width = width;
+	this->height = height;
+	tiles_width = (width + tile_size - 1)/tile_size;
+	tiles_height = (height + tile_size - 1)/tile_size;
+	pixels.assign(width*height, -1);
+	tiles.resize(tiles_width*tiles_height);
+	for(int ty = 0; ty < tiles_height; ++ty) {
+		for(int tx = 0; tx < tiles_width; ++tx) {
+			Tile &tile = tiles[ty*tiles_width + tx];
+			tile.count = (min(width, (tx + 1)*tile_size) - tx*tile_size)
+			           * (min(height, (ty + 1)*tile_size) - ty*tile_size);
+			tile.index = -1;
+		}
+	}
+}
+
+bool Occlusion::add(const Polyspan &polyspan, bool evenodd, bool invert, int index) {
+	const ContextRect &w = polyspan.get_window();
+	assert(w.minx >= 0 && w.miny >= 0 && w.maxx <= width && w.maxy <= height);
+	if (is_hidden(get_bounds(polyspan, invert), index))
+		return false;
+	Add add(*this, index);
+	SwRender::walk(polyspan, evenodd, invert, add);
+	return true;
+}
+
+bool Occlusion::is_hidden(const ContextRect &bounds, int index) const {
+	if (bounds.minx >= bounds.maxx || bounds.miny >= bounds.maxy)
+		return true;
+	int minx = max(0, bounds.minx)/tile_size;
+	int miny = max(0, bounds.miny)/tile_size;
+	int maxx = (min(width, bounds.maxx) - 1)/tile_size;
+	int maxy = (min(height, bounds.maxy) - 1)/tile_size;
+	for(int ty = miny; ty <= maxy; ++ty)
+		for(int tx = minx; tx <= maxx; ++tx)
+			if (tiles[ty*tiles_width + tx].index <= index)
+				return false;
+	return true;
+}
+
+void Occlusion::draw(
+	Surface &target,
+	const Polyspan &polyspan,
+	const Color &color,
+	bool evenodd,
+	bool invert,
+	int index ) const
+{
+	Draw draw(*this, target, color, index);
+	SwRender::walk(polyspan, evenodd, invert, draw);
+}
+
+ContextRect Occlusion::get_bounds(const Polyspan &polyspan, bool invert) {
+	const Polyspan::cover_array &covers = polyspan.get_covers();
+	if (invert || covers.empty())
+		return invert ? polyspan.get_window() : ContextRect();
+
+	// spans are placed between marks of the same row, so only last pixel may be after them
+	ContextRect bounds;
+	bounds.minx = bounds.maxx = covers.front().x;
+	bounds.miny = covers.front().y;
+	bounds.maxy = covers.back().y + 1;
+	for(Polyspan::cover_array::const_iterator i = covers.begin(); i != covers.end(); ++i) {
+		if (bounds.minx > i->x) bounds.minx = i->x;
+		if (bounds.maxx < i->x) bounds.maxx = i->x;
+	}
+	++bounds.maxx;
+	return bounds;
+}
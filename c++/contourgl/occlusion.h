@@ -0,0 +1,98 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _OCCLUSION_H_
+#define _OCCLUSION_H_
+
+#include <vector>
+
+#include "polyspan.h"
+#include "swrender.h"
+
+
+// Occlusion culling for software rendering of painter-ordered polyspans.
+// Fully covered pixel replaces color of pixel below it, so polyspans are added from top
+// to bottom and every pixel keeps index of topmost polyspan which covers it fully.
+// Then polyspans are drawn from bottom to top without pixels covered by polyspans above,
+// and polyspans are skipped entirely when all tiles under their bounds are covered above.
+class Occlusion {
+public:
+	static const int tile_size = 16;
+
+private:
+	struct Tile {
+		// pixels which are not covered yet
+		int count;
+		// minimal index of polyspans which cover pixels of tile, when count is zero
+		int index;
+	};
+
+	// marks fully covered pixels
+	class Add {
+	private:
+		Occlusion &occlusion;
+		int index;
+	public:
+		Add(Occlusion &occlusion, int index): occlusion(occlusion), index(index) { }
+		void operator() (int x, int y, int length, Real alpha);
+	};
+
+	// blends pixels which are not covered by polyspans above
+	class Draw {
+	private:
+		const Occlusion &occlusion;
+		Surface &target;
+		const Color &color;
+		int index;
+	public:
+		Draw(const Occlusion &occlusion, Surface &target, const Color &color, int index):
+			occlusion(occlusion), target(target), color(color), index(index) { }
+		void operator() (int x, int y, int length, Real alpha);
+	};
+
+	int width, height;
+	int tiles_width, tiles_height;
+	std::vector<int> pixels;
+	std::vector<Tile> tiles;
+
+public:
+	Occlusion(): width(), height(), tiles_width(), tiles_height() { }
+
+	void init(int width, int height);
+
+	// polyspans should be added from top to bottom, index is position in order of drawing,
+	// returns false for hidden polyspan, it is not needed to draw it
+	bool add(const Polyspan &polyspan, bool evenodd, bool invert, int index);
+
+	// all pixels inside bounds are covered by polyspans above given one
+	bool is_hidden(const ContextRect &bounds, int index) const;
+
+	// pixels covered by polyspans above are skipped
+	void draw(
+		Surface &target,
+		const Polyspan &polyspan,
+		const Color &color,
+		bool evenodd,
+		bool invert,
+		int index ) const;
+
+	// bounds of pixels which may be touched by polyspan
+	static ContextRect get_bounds(const Polyspan &polyspan, bool invert);
+};
+
+#endif
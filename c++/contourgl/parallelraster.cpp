@@ -0,0 +1,139 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+
+#include <algorithm>
+
+#include "parallelraster.h"
+
+
+using namespace std;
+
+
+void ParallelRaster::RasterTask::run(int thread_index, int)
+	{ owner.raster(owner.parts[thread_index]); }
+
+void ParallelRaster::MergeTask::run(int thread_index, int)
+	{ owner.merge(thread_index); }
+
+
+ParallelRaster::ParallelRaster(ThreadPool &pool, int min_chunks):
+	pool(pool), min_chunks(min_chunks), contour() { }
+
+void ParallelRaster::raster(Part &part) {
+	part.polyspan.init(window);
+	part.polyspan.resume(part.pen.x, part.pen.y, part.start.x, part.start.y, part.closed);
+	contour->to_polyspan(part.polyspan, part.begin, part.end);
+	part.polyspan.sort_marks();
+
+	// marks above and below the window are counted in the first and in the last row
+	const Polyspan::cover_array &marks = part.polyspan.get_covers();
+	int height = window.maxy - window.miny;
+	part.rows.resize(height + 1);
+	int index = 0;
+	for(int y = 0; y < height; ++y) {
+		part.rows[y] = index;
+		while(index < (int)marks.size() && (marks[index].y < window.miny + y + 1 || y + 1 == height))
+			++index;
+	}
+	part.rows[height] = (int)marks.size();
+}
+
+void ParallelRaster::merge(int band) {
+	int y0 = bands[band], y1 = bands[band + 1];
+	if (y0 == y1) return;
+
+	// copy ranges of parts one after another
+	vector<int> offsets(1, 0);
+	for(vector<Part>::const_iterator i = parts.begin(); i != parts.end(); ++i)
+		offsets.front() += i->rows[y0];
+	for(vector<Part>::const_iterator i = parts.begin(); i != parts.end(); ++i) {
+		const Polyspan::cover_array &marks = i->polyspan.get_covers();
+		copy(marks.begin() + i->rows[y0], marks.begin() + i->rows[y1], covers.begin() + offsets.back());
+		offsets.push_back(offsets.back() + i->rows[y1] - i->rows[y0]);
+	}
+
+	// merge neighbour ranges pairwise
+	for(int step = 1; step + 1 < (int)offsets.size(); step *= 2)
+		for(int i = 0; i + step + 1 < (int)offsets.size(); i += 2*step)
+			inplace_merge(
+				covers.begin() + offsets[i],
+				covers.begin() + offsets[i + step],
+				covers.begin() + offsets[min(i + 2*step, (int)offsets.size() - 1)] );
+}
+
+void ParallelRaster::to_polyspan(const Contour &contour, Polyspan &polyspan) {
+	const Contour &lod = contour.get_lod();
+	const Contour::ChunkList &chunks = lod.get_geometry();
+	const Affine &matrix = lod.get_matrix();
+
+	int count = min(pool.count(), (int)chunks.size()/max(1, min_chunks));
+	window = polyspan.get_window();
+	if (count < 2 || window.maxy <= window.miny) {
+		lod.to_polyspan(polyspan);
+		polyspan.sort_marks();
+		return;
+	}
+
+	// split chunks and find state of pen at start of every part,
+	// like Polyspan does: pen stays at start of path after close
+	parts.resize(pool.count());
+	int move = -1;
+	for(int i = 0; i < (int)parts.size(); ++i) {
+		Part &part = parts[i];
+		part.begin = i < count ? (int)((long long)chunks.size()*i/count) : (int)chunks.size();
+		part.end = i < count ? (int)((long long)chunks.size()*(i + 1)/count) : (int)chunks.size();
+
+		for(int j = i > 0 ? parts[i - 1].begin : 0; j < part.begin; ++j)
+			if (chunks[j].type == Contour::MOVE) move = j;
+		part.start = move < 0 ? Vector() : matrix.transform(chunks[move].p1);
+		if (part.begin == 0 || chunks[part.begin - 1].type == Contour::CLOSE || chunks[part.begin - 1].type == Contour::MOVE) {
+			part.pen = part.start;
+			part.closed = true;
+		} else {
+			part.pen = matrix.transform(chunks[part.begin - 1].p1);
+			part.closed = false;
+		}
+	}
+
+	this->contour = &lod;
+	RasterTask raster_task(*this);
+	pool.run(raster_task);
+
+	// split rows into bands with similar count of marks
+	int height = window.maxy - window.miny;
+	int total = 0;
+	for(vector<Part>::const_iterator i = parts.begin(); i != parts.end(); ++i)
+		total += i->rows[height];
+	bands.assign(1, 0);
+	for(int y = 0, band = 1; y < height && band < (int)parts.size(); ++y) {
+		int marks = 0;
+		for(vector<Part>::const_iterator i = parts.begin(); i != parts.end(); ++i)
+			marks += i->rows[y];
+		if ((long long)marks*(int)parts.size() >= (long long)total*band)
+			{ bands.push_back(y); ++band; }
+	}
+	bands.resize(parts.size() + 1, height);
+
+	covers.resize(total);
+	MergeTask merge_task(*this);
+	pool.run(merge_task);
+
+	polyspan.swap_sorted_covers(covers);
+	this->contour = NULL;
+}
@@ -0,0 +1,80 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _PARALLELRASTER_H_
+#define _PARALLELRASTER_H_
+
+#include <vector>
+
+#include "contour.h"
+#include "polyspan.h"
+#include "threadpool.h"
+
+
+// Rasterizes single huge contour by all threads of pool. Chunks of contour are divided
+// into continuous ranges, every thread sends own range into private polyspan and sorts it,
+// then sorted marks are merged by bands of rows (also in parallel) into the target polyspan.
+class ParallelRaster {
+private:
+	class RasterTask: public ThreadPool::Task {
+	private:
+		ParallelRaster &owner;
+	public:
+		explicit RasterTask(ParallelRaster &owner): owner(owner) { }
+		virtual void run(int thread_index, int thread_count);
+	};
+
+	class MergeTask: public ThreadPool::Task {
+	private:
+		ParallelRaster &owner;
+	public:
+		explicit MergeTask(ParallelRaster &owner): owner(owner) { }
+		virtual void run(int thread_index, int thread_count);
+	};
+
+	// range of chunks and state of pen before the first chunk
+	struct Part {
+		int begin, end;
+		Vector pen, start;
+		bool closed;
+		Polyspan polyspan;
+		// offsets of the first mark of every row in sorted polyspan
+		std::vector<int> rows;
+		Part(): begin(), end(), closed(true) { }
+	};
+
+	ThreadPool &pool;
+	int min_chunks;
+	const Contour *contour;
+	ContextRect window;
+	std::vector<Part> parts;
+	// the first row of band of every thread for merging
+	std::vector<int> bands;
+	Polyspan::cover_array covers;
+
+	void raster(Part &part);
+	void merge(int band);
+
+public:
+	// contours with less than min_chunks chunks per thread are sent by one thread
+	explicit ParallelRaster(ThreadPool &pool, int min_chunks = 4096);
+
+	// like Contour::to_polyspan followed by Polyspan::sort_marks
+	void to_polyspan(const Contour &contour, Polyspan &polyspan);
+};
+
+#endif
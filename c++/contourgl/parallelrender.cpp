@@ -0,0 +1,99 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cassert>
+
+#include "parallelrender.h"
+
+
+using namespace std;
+
+
+void ParallelRender::DrawTask::run(int, int)
+	{ owner.draw_paths(); }
+
+
+ParallelRender::ParallelRender(ThreadPool &pool, int window_size):
+	pool(pool),
+	surface(),
+	slots(window_size > 0 ? window_size : 2*pool.count()),
+	next_path(),
+	next_composite(),
+	compositing()
+{ }
+
+void ParallelRender::send_surface(Surface *surface)
+	{ this->surface = surface; }
+
+Surface* ParallelRender::receive_surface()
+	{ return surface; }
+
+void ParallelRender::send_paths(const Path *paths, int count)
+	{ this->paths.assign(paths, paths + count); }
+
+void ParallelRender::composite(unique_lock<std::mutex> &lock) {
+	// only one thread composites, other ones just mark their polyspans as ready
+	if (compositing) return;
+	compositing = true;
+	while(next_composite < (int)paths.size()) {
+		Slot &slot = slots[next_composite % slots.size()];
+		if (!slot.ready) break;
+
+		lock.unlock();
+		const Path &path = paths[next_composite];
+		SwRender::polyspan(*surface, slot.polyspan, path.color, path.evenodd, path.invert);
+		lock.lock();
+
+		slot.ready = false;
+		++next_composite;
+		condition.notify_all();
+	}
+	compositing = false;
+}
+
+void ParallelRender::draw_paths() {
+	const int window_size = (int)slots.size();
+	unique_lock<std::mutex> lock(mutex);
+	while(next_path < (int)paths.size()) {
+		int index = next_path++;
+
+		// wait for free slot
+		while(index >= next_composite + window_size)
+			condition.wait(lock);
+		Slot &slot = slots[index % window_size];
+		lock.unlock();
+
+		slot.polyspan.init(0, 0, surface->width, surface->height);
+		paths[index].contour->to_polyspan(slot.polyspan);
+		slot.polyspan.sort_marks();
+
+		lock.lock();
+		slot.ready = true;
+		composite(lock);
+	}
+}
+
+void ParallelRender::draw() {
+	assert(surface);
+	next_path = 0;
+	next_composite = 0;
+	compositing = false;
+	DrawTask task(*this);
+	pool.run(task);
+	assert(next_composite == (int)paths.size());
+}
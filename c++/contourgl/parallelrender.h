@@ -0,0 +1,81 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _PARALLELRENDER_H_
+#define _PARALLELRENDER_H_
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "contour.h"
+#include "polyspan.h"
+#include "swrender.h"
+#include "threadpool.h"
+
+
+// Rasterizes polyspans of contours in parallel and composites them strictly in order of paths,
+// for scenes with few but huge contours. Threads take contours one by one, polyspan of contour n
+// is placed into slot n % window_size, and thread which finishes next polyspan in order
+// composites all ready ones. Contour waits for free slot, so memory is bounded by window size.
+class ParallelRender {
+public:
+	typedef ContourPath Path;
+
+private:
+	class DrawTask: public ThreadPool::Task {
+	private:
+		ParallelRender &owner;
+	public:
+		explicit DrawTask(ParallelRender &owner): owner(owner) { }
+		virtual void run(int thread_index, int thread_count);
+	};
+
+	struct Slot {
+		Polyspan polyspan;
+		bool ready;
+		Slot(): ready() { }
+	};
+
+	ThreadPool &pool;
+	Surface *surface;
+	std::vector<Path> paths;
+	std::vector<Slot> slots;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	int next_path;
+	int next_composite;
+	bool compositing;
+
+	void draw_paths();
+	void composite(std::unique_lock<std::mutex> &lock);
+
+public:
+	// zero window size means two slots per thread
+	explicit ParallelRender(ThreadPool &pool, int window_size = 0);
+
+	void send_surface(Surface *surface);
+	Surface* receive_surface();
+	void send_paths(const Path *paths, int count);
+	void draw();
+
+	int get_window_size() const { return (int)slots.size(); }
+};
+
+#endif
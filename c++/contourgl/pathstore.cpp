@@ -0,0 +1,249 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+
+#include "pathstore.h"
+#include "flatten.h"
+
+
+using namespace std;
+
+
+void PathStore::clear() {
+	paths.clear();
+	geometries.clear();
+	geometry_indices.clear();
+	verbs.clear();
+	points.clear();
+	tangents.clear();
+}
+
+void PathStore::reserve(int paths_count, int chunks_count) {
+	paths.reserve(paths_count);
+	verbs.reserve(chunks_count + paths_count*align);
+	points.reserve(chunks_count + paths_count*align);
+}
+
+ContextRect PathStore::calc_bounds(int begin, int end, int tangents_begin, const Affine &matrix) const {
+	// curves may go out of their end points, so bounds of control points and arcs are included
+	Vector p0 = matrix.transform(Vector(points[begin]));
+	Rect r(p0, p0);
+	const vec2f *t = tangents.empty() ? NULL : &tangents[tangents_begin];
+	for(int i = begin; i < end; ++i) {
+		Vector p1 = matrix.transform(Vector(points[i]));
+		r = r.expand(p1);
+		if (verbs[i] == Contour::CONIC) {
+			Vector center;
+			Real radius = 0.0;
+			Real radians0 = 0.0;
+			Real radians1 = 0.0;
+			if (Contour::conic_convert(p0, p1, matrix.transform_vector(Vector(*t)), center, radius, radians0, radians1)) {
+				Rect b = Contour::conic_bounds(p0, p1, center, radius, radians0, radians1);
+				r = r.expand(b.p0).expand(b.p1);
+			}
+			++t;
+		} else
+		if (verbs[i] == Contour::CUBIC) {
+			Vector pp0, pp1;
+			Contour::cubic_convert(p0, p1, matrix.transform_vector(Vector(t[0])), matrix.transform_vector(Vector(t[1])), pp0, pp1);
+			r = r.expand(pp0).expand(pp1);
+			t += 2;
+		}
+		p0 = p1;
+	}
+
+	ContextRect bounds;
+	bounds.minx = (int)floor(r.p0.x);
+	bounds.miny = (int)floor(r.p0.y);
+	bounds.maxx = (int)floor(r.p1.x) + 1;
+	bounds.maxy = (int)floor(r.p1.y) + 1;
+	return bounds;
+}
+
+void PathStore::update_bounds(Geometry &geometry) const
+	{ geometry.bounds = calc_bounds(geometry.begin, geometry.end, geometry.tangents_begin, Affine()); }
+
+int PathStore::add_geometry(const Contour::ChunkList &chunks, const Affine &matrix) {
+	// geometry is copied as is and then transformed by matrix in batch
+	Geometry geometry = {};
+	geometry.begin = (int)points.size();
+	geometry.tangents_begin = (int)tangents.size();
+	for(Contour::ChunkList::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+		verbs.push_back((Verb)i->type);
+		points.push_back(vec2f(i->p1));
+		if (i->type == Contour::CONIC || i->type == Contour::CUBIC)
+			tangents.push_back(vec2f(i->t0));
+		if (i->type == Contour::CUBIC)
+			tangents.push_back(vec2f(i->t1));
+	}
+	geometry.end = (int)points.size();
+
+	if (!matrix.is_identity()) {
+		affine2f m(matrix);
+		m.transform_points(&points[geometry.begin], geometry.end - geometry.begin);
+		if ((int)tangents.size() > geometry.tangents_begin)
+			m.transform_vectors(&tangents[geometry.tangents_begin], (int)tangents.size() - geometry.tangents_begin);
+	}
+
+	do {
+		verbs.push_back((Verb)Contour::CLOSE);
+		points.push_back(points[geometry.begin]);
+	} while(points.size() % align);
+
+	update_bounds(geometry);
+	geometries.push_back(geometry);
+	return (int)geometries.size() - 1;
+}
+
+void PathStore::add(
+	const Contour &contour,
+	const Color &color,
+	bool invert,
+	bool evenodd,
+	const Affine &transform )
+{
+	assert(align > 0);
+
+	const Contour::ChunkList &chunks = contour.get_geometry();
+	if (chunks.empty()) return;
+	Affine matrix = transform*contour.get_matrix();
+
+	Path path = {};
+	path.color = color;
+	path.invert = invert;
+	path.evenodd = evenodd;
+
+	if (instancing) {
+		// copies of contour share geometry
+		map<const Contour::ChunkList*, int>::const_iterator i = geometry_indices.find(&chunks);
+		if (i == geometry_indices.end()) {
+			path.geometry = add_geometry(chunks, Affine());
+			geometry_indices[&chunks] = path.geometry;
+		} else {
+			path.geometry = i->second;
+		}
+		path.transform = affine2f(matrix);
+	} else {
+		path.geometry = add_geometry(chunks, matrix);
+	}
+
+	const Geometry &geometry = geometries[path.geometry];
+	path.bounds = geometry.bounds;
+	path.begin = geometry.begin;
+	path.end = geometry.end;
+	path.tangents_begin = geometry.tangents_begin;
+	paths.push_back(path);
+}
+
+void PathStore::transform(const Affine &matrix) {
+	affine2f m(matrix);
+	if (instancing) {
+		// only matrices are changed
+		for(vector<Path>::iterator i = paths.begin(); i != paths.end(); ++i)
+			i->transform = m*i->transform;
+		return;
+	}
+
+	// closing and padding points are also transformed, so they stay equal to the first points
+	if (!points.empty())
+		m.transform_points(&points.front(), (int)points.size());
+	if (!tangents.empty())
+		m.transform_vectors(&tangents.front(), (int)tangents.size());
+	for(vector<Geometry>::iterator i = geometries.begin(); i != geometries.end(); ++i)
+		update_bounds(*i);
+	for(vector<Path>::iterator i = paths.begin(); i != paths.end(); ++i)
+		i->bounds = geometries[i->geometry].bounds;
+}
+
+size_t PathStore::get_memory_size() const {
+	return paths.capacity()*sizeof(Path)
+	     + geometries.capacity()*sizeof(Geometry)
+	     + verbs.capacity()*sizeof(Verb)
+	     + points.capacity()*sizeof(vec2f)
+	     + tangents.capacity()*sizeof(vec2f);
+}
+
+ContextRect PathStore::get_bounds(const Path &path) const {
+	if (path.transform.is_identity())
+		return path.bounds;
+
+	// arc is transformed to another arc only by conformal transformation
+	if (!path.transform.is_conformal())
+		return calc_bounds(path.begin, path.end, path.tangents_begin, Affine(path.transform));
+
+	rectf r = path.transform.transform_bounds(rectf(
+		(float)path.bounds.minx, (float)path.bounds.miny,
+		(float)path.bounds.maxx, (float)path.bounds.maxy ));
+	ContextRect bounds;
+	bounds.minx = (int)floor(r.p0.x);
+	bounds.miny = (int)floor(r.p0.y);
+	bounds.maxx = (int)ceil(r.p1.x);
+	bounds.maxy = (int)ceil(r.p1.y);
+	return bounds;
+}
+
+void PathStore::to_polyspan(const Path &path, Polyspan &polyspan) const {
+	const ContextRect &w = polyspan.get_window();
+	Rect window(w.minx, w.miny, w.maxx, w.maxy);
+
+	Affine matrix(path.transform);
+
+	polyspan.move_to(0.0, 0.0);
+	Vector p0;
+	const vec2f *t = tangents.empty() ? NULL : &tangents[path.tangents_begin];
+	for(int i = path.begin; i < path.end; ++i) {
+		Vector p1 = matrix.transform(Vector(points[i]));
+		switch(verbs[i]) {
+			case Contour::CLOSE:
+				polyspan.close();
+				break;
+			case Contour::MOVE:
+				polyspan.move_to(p1.x, p1.y);
+				break;
+			case Contour::LINE:
+				polyspan.line_to(p1.x, p1.y);
+				break;
+			case Contour::CONIC: {
+					Vector center;
+					Real radius = 0.0;
+					Real radians0 = 0.0;
+					Real radians1 = 0.0;
+					if ( Contour::conic_convert(p0, p1, matrix.transform_vector(Vector(*t)), center, radius, radians0, radians1)
+					  && window.intersects(Contour::conic_bounds(p0, p1, center, radius, radians0, radians1)) )
+					{
+						Polyspan::LineTo target(polyspan);
+						Flatten::arc(center, radius, radians0, radians1, p1, Flatten::default_tolerance, target);
+					} else {
+						polyspan.line_to(p1.x, p1.y);
+					}
+					++t;
+				}
+				break;
+			case Contour::CUBIC: {
+					Vector pp0, pp1;
+					Contour::cubic_convert(p0, p1, matrix.transform_vector(Vector(t[0])), matrix.transform_vector(Vector(t[1])), pp0, pp1);
+					polyspan.cubic_to(pp0.x, pp0.y, pp1.x, pp1.y, p1.x, p1.y);
+					t += 2;
+				}
+				break;
+			default:
+				break;
+		}
+		p0 = p1;
+	}
+}
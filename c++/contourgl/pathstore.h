@@ -0,0 +1,117 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _PATHSTORE_H_
+#define _PATHSTORE_H_
+
+#include <vector>
+#include <map>
+
+#include "geometry.h"
+#include "contour.h"
+#include "polyspan.h"
+#include "swrender.h"
+
+
+// Paths of the whole scene in contiguous arrays: one verb (Contour::ChunkType) per chunk,
+// end points of chunks in one array and tangents of curves in another one.
+// Points of every path are followed by its first point and padded by it up to the alignment,
+// so points of paths can be sent to renderers as is.
+// In instancing mode geometry of contours is stored once for all paths which share it
+// (copies of one contour), and every path has own transformation matrix,
+// otherwise transformation is applied to points and every path has own geometry.
+class PathStore {
+public:
+	typedef unsigned char Verb;
+
+	struct Path {
+		// bounds of points before transformation by matrix of path
+		ContextRect bounds;
+		// verbs and points have the same indices
+		int begin;
+		int end;
+		int tangents_begin;
+		int geometry;
+		affine2f transform;
+		Color color;
+		bool invert;
+		bool evenodd;
+	};
+
+private:
+	struct Geometry {
+		ContextRect bounds;
+		int begin;
+		int end;
+		int tangents_begin;
+	};
+
+	int align;
+	bool instancing;
+	std::vector<Path> paths;
+	std::vector<Geometry> geometries;
+	std::map<const Contour::ChunkList*, int> geometry_indices;
+	std::vector<Verb> verbs;
+	std::vector<vec2f> points;
+	std::vector<vec2f> tangents;
+
+	int add_geometry(const Contour::ChunkList &chunks, const Affine &matrix);
+	ContextRect calc_bounds(int begin, int end, int tangents_begin, const Affine &matrix) const;
+	void update_bounds(Geometry &geometry) const;
+
+public:
+	explicit PathStore(int align = 1, bool instancing = false):
+		align(align), instancing(instancing) { }
+
+	void clear();
+	void init(int align, bool instancing = false)
+		{ clear(); this->align = align; this->instancing = instancing; }
+	void reserve(int paths_count, int chunks_count);
+
+	// empty contours are skipped,
+	// contours should not be changed while store is filled
+	void add(
+		const Contour &contour,
+		const Color &color,
+		bool invert,
+		bool evenodd,
+		const Affine &transform = Affine() );
+	// transform all stored paths
+	void transform(const Affine &matrix);
+
+	int get_align() const { return align; }
+	bool is_instancing() const { return instancing; }
+	int get_geometries_count() const { return (int)geometries.size(); }
+	const std::vector<Path>& get_paths() const { return paths; }
+	const std::vector<Verb>& get_verbs() const { return verbs; }
+	const std::vector<vec2f>& get_points() const { return points; }
+	const std::vector<vec2f>& get_tangents() const { return tangents; }
+
+	const vec2f* get_points_data() const
+		{ return points.empty() ? NULL : &points.front(); }
+	int get_points_count() const
+		{ return (int)points.size(); }
+
+	size_t get_memory_size() const;
+
+	// bounds of path after transformation
+	ContextRect get_bounds(const Path &path) const;
+
+	void to_polyspan(const Path &path, Polyspan &polyspan) const;
+};
+
+#endif
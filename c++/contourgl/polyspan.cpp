@@ -32,7 +32,9 @@ Polyspan::Polyspan():
 	cur_y(0.0),
 	close_x(0.0),
 	close_y(0.0),
-	flags(NotSorted)
+	flags(NotSorted),
+	reserve_step(1024*1024),
+	max_covers(0)
 { }
 
 void Polyspan::clear() {
@@ -46,8 +48,12 @@ void Polyspan::clear() {
 // add the current cell, but only if there is information to add
 void Polyspan::addcurrent() {
 	if (current.cover || current.area) {
-		if (covers.size() == covers.capacity())
-			covers.reserve(covers.size() + 1024*1024);
+		if (max_covers && (int)covers.size() >= max_covers)
+			{ flags |= Overflow; return; }
+		if (covers.size() == covers.capacity()) {
+			size_t size = covers.size() + max(covers.size(), (size_t)reserve_step);
+			covers.reserve(max_covers ? min(size, (size_t)max_covers) : size);
+		}
 		covers.push_back(current);
 	}
 }
@@ -72,6 +78,13 @@ void Polyspan::close() {
 	}
 }
 
+// close the primitives and store the current cell, so all marks of them are in covers
+void Polyspan::finish() {
+	close();
+	addcurrent();
+	current.setcover(0, 0);
+}
+
 // Not recommended - destroys any separation of spans currently held
 void Polyspan::merge_all() {
 	sort(covers.begin(), covers.end());
@@ -91,6 +104,17 @@ void Polyspan::sort_marks() {
 	}
 }
 
+void Polyspan::translate(int dx, int dy) {
+	if (!dx && !dy) return;
+	for(cover_array::iterator i = covers.begin(); i != covers.end(); ++i)
+		{ i->x += dx; i->y += dy; }
+	current.setcoord(current.x + dx, current.y + dy);
+	cur_x += dx; cur_y += dy;
+	close_x += dx; close_y += dy;
+	window.minx += dx; window.maxx += dx;
+	window.miny += dy; window.maxy += dy;
+}
+
 // encapsulate the current sublist of marks (used for drawing)
 void Polyspan::encapsulate_current() {
 	// sort the current list then reposition the open list section
@@ -108,6 +132,17 @@ void Polyspan::move_to(Real x, Real y) {
 	close_x = cur_x = x;
 }
 
+// continue primitive list started in other polyspan
+void Polyspan::resume(Real x, Real y, Real close_x, Real close_y, bool closed) {
+	close();
+	move_pen((int)floor(x), (int)floor(y));
+	cur_x = x;
+	cur_y = y;
+	this->close_x = close_x;
+	this->close_y = close_y;
+	if (closed) flags &= ~NotClosed; else flags |= NotClosed;
+}
+
 // primitive_to functions
 void Polyspan::line_to(Real x, Real y) {
 	Real n[4] = {0, 0, 0, 0};
@@ -272,121 +307,17 @@ bool Polyspan::clip_conic(const Vector *p, const ContextRect &r) {
 			(maxy < r.miny);
 }
 
-Real Polyspan::max_edges_conic(const Vector *p) {
-	const Real x1 = p[1][0] - p[0][0];
-	const Real y1 = p[1][1] - p[0][1];
-
-	const Real x2 = p[2][0] - p[1][0];
-	const Real y2 = p[2][1] - p[1][1];
-
-	const Real d1 = x1*x1 + y1*y1;
-	const Real d2 = x2*x2 + y2*y2;
-
-	return max(d1,d2);
-}
-
-void Polyspan::subd_conic_stack(Vector *arc) {
-	/*
-
-	b0
-	*		0+1 a
-	b1 b	*		1+2*1+2 a
-	*		1+2	b	*
-	b2 		*
-	*
-
-	0.1.2 ->	0.1 2 3.4
-
-	*/
-
-	Real a, b;
-
-
-	arc[4][0] = arc[2][0];
-	b = arc[1][0];
-
-	a = arc[1][0] = (arc[0][0] + b)/2;
-	b = arc[3][0] = (arc[4][0] + b)/2;
-	arc[2][0] = (a + b)/2;
-
-
-	arc[4][1] = arc[2][1];
-	b = arc[1][1];
-
-	a = arc[1][1] = (arc[0][1] + b)/2;
-
-	b = arc[3][1] = (arc[4][1] + b)/2;
-	arc[2][1] = (a + b)/2;
-
-	/* //USING SIMD
-
-	arc[4] = arc[2];
-
-	arc[3] = (arc[2] + arc[1])/2;
-	arc[1] = (arc[0] + arc[1])/2;
-
-	arc[2] = (arc[1] + arc[3])/2;
-
-	*/
-}
-
 void Polyspan::conic_to(Real x1, Real y1, Real x, Real y) {
-	Vector *current = arc;
-	int		level = 0;
-	int 	num = 0;
-	bool	onsecond = false;
-
-	arc[0] = Vector(x, y);
-	arc[1] = Vector(x1, y1);
-	arc[2] = Vector(cur_x, cur_y);
+	Vector p[3] = { Vector(cur_x, cur_y), Vector(x1, y1), Vector(x, y) };
 
 	// just draw the line if it's outside
-	if (clip_conic(arc, window))
-	{
-		line_to(x,y);
+	if (clip_conic(p, window)) {
+		line_to(x, y);
 		return;
 	}
 
-	// Ok so it's not super degenerate, subdivide and draw (run through minimum subdivision levels first)
-	while(current >= arc) {
-		assert(num < MAX_SUBDIVISION_SIZE);
-
-		// if the curve is clipping then draw degenerate
-		if (clip_conic(current, window)) {
-			line_to(current[0][0],current[0][1]); //backwards so front is destination
-			current -= 2;
-			if (onsecond) level--;
-			onsecond = true;
-			num--;
-			continue;
-		} else
-		// if we are not at the level minimum
-		if (level < MIN_SUBDIVISION_DRAW_LEVELS) {
-			subd_conic_stack(current);
-			current += 2; 		// cursor on second curve
-			level ++;
-			num ++;
-			onsecond = false;
-			continue;
-		} else
-		// split it again, if it's too big
-		if (max_edges_conic(current) > 0.25) { // distance of .5 (cover no more than half the pixel)
-			subd_conic_stack(current);
-			current += 2; 		// cursor on second curve
-			level ++;
-			num ++;
-			onsecond = false;
-		} else { // NOT TOO BIG? RENDER!!!
-			// cur_x, cur_y = current[2], so we need to go 1,0
-			line_to(current[1][0], current[1][1]);
-			line_to(current[0][0], current[0][1]);
-
-			current -= 2;
-			if (onsecond) level--;
-			num--;
-			onsecond = true;
-		}
-	}
+	LineTo target(*this);
+	Flatten::conic(p[0], p[1], p[2], Flatten::default_tolerance, target);
 }
 
 bool Polyspan::clip_cubic(const Vector *p, const ContextRect &r) {
@@ -396,129 +327,17 @@ bool Polyspan::clip_cubic(const Vector *p, const ContextRect &r) {
 			((p[0][1] < r.miny) && (p[1][1] < r.miny) && (p[2][1] < r.miny) && (p[3][1] < r.miny));
 }
 
-Real Polyspan::max_edges_cubic(const Vector *p) {
-	const Real x1 = p[1][0] - p[0][0];
-	const Real y1 = p[1][1] - p[0][1];
-
-	const Real x2 = p[2][0] - p[1][0];
-	const Real y2 = p[2][1] - p[1][1];
-
-	const Real x3 = p[3][0] - p[2][0];
-	const Real y3 = p[3][1] - p[2][1];
-
-	const Real d1 = x1*x1 + y1*y1;
-	const Real d2 = x2*x2 + y2*y2;
-	const Real d3 = x3*x3 + y3*y3;
-
-	return max(max(d1, d2), d3);
-}
-
-void Polyspan::subd_cubic_stack(Vector *arc) {
-	Real a, b, c;
-
-	/*
-
-	b0
-	*		0+1 a
-	b1 b	*		1+2*1+2 a
-	*		1+2	b	*			0+3*1+3*2+3
-	b2 c	*		1+2*2+2	b	*
-	*		2+3	c	*
-	b3 		*
-	*
-
-	0.1 2.3 ->	0.1 2 3 4 5.6
-
-	*/
-
-	arc[6][0] = arc[3][0];
-
-	b = arc[1][0];
-	c = arc[2][0];
-
-	a = arc[1][0] = (arc[0][0] + b)/2;
-	b = (b + c)/2;
-	c = arc[5][0] = (arc[6][0] + c)/2;
-
-	a = arc[2][0] = (a + b)/2;
-	b = arc[4][0] = (b + c)/2;
-
-	arc[3][0] = (a + b)/2;
-
-
-	arc[6][1] = arc[3][1];
-
-	b = arc[1][1];
-	c = arc[2][1];
-
-	a = arc[1][1] = (arc[0][1] + b)/2;
-	b = (b + c)/2;
-	c = arc[5][1] = (arc[6][1] + c)/2;
-
-	a = arc[2][1] = (a + b)/2;
-	b = arc[4][1] = (b + c)/2;
-
-	arc[3][1] = (a + b)/2;
-}
-
 void Polyspan::cubic_to(Real x1, Real y1, Real x2, Real y2, Real x, Real y) {
-	Vector *current = arc;
-	int		num = 0;
-	int		level = 0;
-	bool	onsecond = false;
-
-	arc[0] = Vector(x, y);
-	arc[1] = Vector(x2, y2);
-	arc[2] = Vector(x1, y1);
-	arc[3] = Vector(cur_x, cur_y);
+	Vector p[4] = { Vector(cur_x, cur_y), Vector(x1, y1), Vector(x2, y2), Vector(x, y) };
 
 	// just draw the line if it's outside
-	if (clip_cubic(arc, window)) {
-		line_to(x,y);
+	if (clip_cubic(p, window)) {
+		line_to(x, y);
 		return;
 	}
 
-	// Ok so it's not super degenerate, subdivide and draw (run through minimum subdivision levels first)
-	while(current >= arc) { // once current goes below arc, there are no more curves left
-		assert(num < MAX_SUBDIVISION_SIZE);
-
-		// if we are not at the level minimum
-		if (level < MIN_SUBDIVISION_DRAW_LEVELS) {
-			subd_cubic_stack(current);
-			current += 3; 		// cursor on second curve
-			level ++;
-			num ++;
-			onsecond = false;
-			continue;
-		} else
-		// if the curve is clipping then draw degenerate
-		if (clip_cubic(current, window)) {
-			line_to(current[0][0], current[0][1]); // backwards so front is destination
-			current -= 3;
-			if (onsecond) level--;
-			onsecond = true;
-			num --;
-			continue;
-		} else
-		// split it again, if it's too big
-		if (max_edges_cubic(current) > 0.25) { //could use max_edges<3>
-			subd_cubic_stack(current);
-			current += 3; 		// cursor on second curve
-			level ++;
-			num ++;
-			onsecond = false;
-		} else { // NOT TOO BIG? RENDER!!!
-			// cur_x, cur_y = current[3], so we need to go 2,1,0
-			line_to(current[2][0], current[2][1]);
-			line_to(current[1][0], current[1][1]);
-			line_to(current[0][0], current[0][1]);
-
-			current -= 3;
-			if (onsecond) level--;
-			num --;
-			onsecond = true;
-		}
-	}
+	LineTo target(*this);
+	Flatten::cubic(p[0], p[1], p[2], p[3], Flatten::default_tolerance, target);
 }
 
 void Polyspan::draw_scanline(int y, Real x1, Real y1, Real x2, Real y2) {
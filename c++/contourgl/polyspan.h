@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "geometry.h"
+#include "flatten.h"
 
 class Polyspan {
 public:
@@ -48,20 +49,21 @@ public:
 
 	typedef	std::vector<PenMark> cover_array;
 
+	// receives points of flattened curves
+	struct LineTo {
+		Polyspan &polyspan;
+		explicit LineTo(Polyspan &polyspan): polyspan(polyspan) { }
+		void operator() (const Vector &p) { polyspan.line_to(p.x, p.y); }
+	};
+
 	//for assignment to flags value
 	enum PolySpanFlags {
 		NotSorted = 0x8000,
-		NotClosed =	0x4000
-	};
-
-	enum {
-		MAX_SUBDIVISION_SIZE = 64,
-		MIN_SUBDIVISION_DRAW_LEVELS = 4
+		NotClosed =	0x4000,
+		Overflow  = 0x2000
 	};
 
 private:
-	Vector			arc[3*MAX_SUBDIVISION_SIZE + 1];
-
 	cover_array		covers;
 	PenMark			current;
 
@@ -78,6 +80,12 @@ private:
 	//flags for the current segment
 	int				flags;
 
+	//minimal count of marks reserved at once when covers are full
+	int				reserve_step;
+
+	//marks beyond this count are dropped, 0 means no limit
+	int				max_covers;
+
 	//the window that will be drawn (used for clipping)
 	ContextRect		window;
 
@@ -88,12 +96,7 @@ private:
 	void move_pen(int x, int y);
 
 	static bool clip_conic(const Vector *p, const ContextRect &r);
-	static Real max_edges_conic(const Vector *p);
-	static void subd_conic_stack(Vector *arc);
-
 	static bool clip_cubic(const Vector *p, const ContextRect &r);
-	static Real max_edges_cubic(const Vector *p);
-	static void subd_cubic_stack(Vector *arc);
 
 public:
 	Polyspan();
@@ -120,18 +123,48 @@ public:
 	//close the primitives with a line (or rendering will not work as expected)
 	void close();
 
+	//close the primitives and store the current cell, so all marks of them are in covers
+	void finish();
+
 	// Not recommended - destroys any separation of spans currently held
 	void merge_all();
 
 	//will sort the marks if they are not sorted
 	void sort_marks();
 
+	//move window and all marks by whole pixels, order of marks is kept
+	void translate(int dx, int dy);
+
+	// takes marks calculated elsewhere, they should be sorted and clipped by window,
+	// given array receives previous marks of polyspan
+	void swap_sorted_covers(cover_array &covers)
+		{ this->covers.swap(covers); open_index = 0; flags &= ~NotSorted; }
+
+	// smaller step keeps memory low for polyspans with few marks,
+	// reserved memory grows geometrically, but not slower than by step
+	void set_reserve_step(int step)
+		{ reserve_step = step > 0 ? step : 1; }
+
+	// hard limit of memory, when it is reached marks are dropped and overflowed() is set,
+	// result is not valid then and should be built again with smaller window
+	void set_max_covers(int count)
+		{ max_covers = count > 0 ? count : 0; }
+	bool overflowed() const
+		{ return flags & Overflow; }
+
+	// frees reserved memory of covers, for polyspans which are kept for long time
+	void shrink()
+		{ cover_array(covers).swap(covers); }
+
 	//encapsulate the current sublist of marks (used for drawing)
 	void encapsulate_current();
 
 	//move to start a new primitive list (enclose the last primitive if need be)
 	void move_to(Real x, Real y);
 
+	//continue primitive list started in other polyspan: pen is at x, y and the list starts at close_x, close_y
+	void resume(Real x, Real y, Real close_x, Real close_y, bool closed);
+
 	//primitive_to functions
 	void line_to(Real x, Real y);
 	void conic_to(Real x1, Real y1, Real x, Real y);
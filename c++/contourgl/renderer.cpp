@@ -0,0 +1,563 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+#include <cmath>
+
+#include <map>
+
+#include "renderer.h"
+#include "clrender.h"
+#include "glrender.h"
+#include "bandrender.h"
+#include "batchrender.h"
+#include "hybridrender.h"
+#include "maskcache.h"
+#include "parallelrender.h"
+#include "pathstore.h"
+#include "threadpool.h"
+
+#ifdef CUDA
+#include "cudarender.h"
+#endif
+
+
+using namespace std;
+
+
+namespace {
+
+// points of all paths in one array, every path is closed by its first point,
+// in instancing mode points of shared contours are stored once and
+// transformations of paths are returned separately
+void prepare_points(
+	const Renderer::Path *paths,
+	int count,
+	int align,
+	bool instancing,
+	vector<ClRender3::Path> &out_paths,
+	vector<affine2f> &out_transforms,
+	PathStore &store )
+{
+	store.init(align, instancing);
+	for(const Renderer::Path *i = paths, *end = paths + count; i < end; ++i)
+		store.add(i->contour->get_lod(i->transform), i->color, i->invert, i->evenodd, i->transform);
+
+	out_paths.clear();
+	out_paths.reserve(store.get_paths().size());
+	out_transforms.clear();
+	out_transforms.reserve(store.get_paths().size());
+	for(vector<PathStore::Path>::const_iterator i = store.get_paths().begin(); i != store.get_paths().end(); ++i) {
+		ClRender3::Path path = {};
+		path.bounds = i->bounds;
+		path.begin = i->begin;
+		path.end = i->end;
+		path.color = i->color;
+		path.invert = i->invert;
+		path.evenodd = i->evenodd;
+		out_paths.push_back(path);
+		out_transforms.push_back(i->transform);
+	}
+}
+
+// for renderers without instancing: paths refer to copies of contours with applied transformations,
+// copies share geometry with source contours, and transformation is applied while points are sent
+void transform_contours(const Renderer::Path *paths, int count, vector<Contour> &contours, vector<ContourPath> &out_paths) {
+	contours.clear();
+	contours.reserve(count);
+	out_paths.assign(paths, paths + count);
+	for(int i = 0; i < count; ++i) {
+		if (!paths[i].transform.is_identity()) {
+			contours.push_back(*paths[i].contour);
+			contours.back().transform(paths[i].transform);
+			out_paths[i].contour = &contours.back();
+		}
+	}
+}
+
+
+class SwRenderer: public Renderer {
+private:
+	// builds mask of path for cache
+	struct BuildMask {
+		const PathStore &store;
+		const PathStore::Path &path;
+		BuildMask(const PathStore &store, const PathStore::Path &path):
+			store(store), path(path) { }
+		void operator() (Polyspan &polyspan, const affine2f &transform) const {
+			PathStore::Path p = path;
+			p.transform = transform;
+			polyspan.init(store.get_bounds(p));
+			store.to_polyspan(p, polyspan);
+			polyspan.sort_marks();
+		}
+	};
+
+	Surface *surface;
+	PathStore store;
+	vector<MaskCache::GeometryPtr> geometries;
+	vector<const Contour*> contours;
+	vector<Vector> shape_points;
+	// masks are kept between frames
+	MaskCache masks;
+	Polyspan polyspan;
+
+	bool draw_shape(const PathStore::Path &path, const Contour &contour) {
+		if (path.invert || contour.get_shape() == Contour::GENERAL) return false;
+
+		// convex polygon stays convex after transformation, but rectangle may be rotated
+		const vector<Vector> &points = contour.get_shape_points();
+		shape_points.resize(points.size());
+		for(int i = 0; i < (int)points.size(); ++i)
+			shape_points[i] = Vector(path.transform.transform(vec2f(points[i])));
+		Rect bounds(shape_points.front(), shape_points.front());
+		for(vector<Vector>::const_iterator i = shape_points.begin(); i != shape_points.end(); ++i)
+			bounds = bounds.expand(*i);
+		if ( bounds.p0.x < 0 || bounds.p1.x > surface->width
+		  || bounds.p0.y < 0 || bounds.p1.y > surface->height ) return false;
+
+		switch(Contour::classify(shape_points)) {
+			case Contour::RECTANGLE:
+				SwRender::rect(*surface, bounds, path.color);
+				return true;
+			case Contour::CONVEX:
+				SwRender::convex(*surface, shape_points, path.color);
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	bool draw_mask(const PathStore::Path &path, const MaskCache::GeometryPtr &geometry) {
+		// window of cached polyspan covers whole path (and one more pixel after snapping
+		// to subpixel grid), so it should be inside surface
+		ContextRect bounds = store.get_bounds(path);
+		if ( path.invert
+		  || bounds.minx < 0 || bounds.maxx + 1 > surface->width
+		  || bounds.miny < 0 || bounds.maxy + 1 > surface->height ) return false;
+
+		BuildMask build(store, path);
+		SwRender::polyspan(*surface, masks.get(geometry, path.transform, build), path.color, path.evenodd, path.invert);
+		return true;
+	}
+
+public:
+	explicit SwRenderer(Environment&): surface(), store(1, true) { }
+
+	virtual void send_surface(Surface *surface)
+		{ this->surface = surface; }
+	virtual Surface* receive_surface()
+		{ return surface; }
+
+	virtual void send_paths(const Path *paths, int count) {
+		store.clear();
+		geometries.clear();
+		contours.clear();
+		for(const Path *i = paths, *end = paths + count; i < end; ++i) {
+			// level of detail is chosen by scale of instance
+			const Contour &contour = i->contour->get_lod(i->transform);
+			int size = (int)store.get_paths().size();
+			store.add(contour, i->color, i->invert, i->evenodd, i->transform);
+			if ((int)store.get_paths().size() > size) {
+				geometries.push_back(contour.get_geometry_ptr());
+				contours.push_back(&contour);
+			}
+		}
+	}
+
+	virtual void draw() {
+		assert(surface);
+		const vector<PathStore::Path> &paths = store.get_paths();
+		for(int i = 0; i < (int)paths.size(); ++i) {
+			if (draw_shape(paths[i], *contours[i])) continue;
+			if (draw_mask(paths[i], geometries[i])) continue;
+			polyspan.init(0, 0, surface->width, surface->height);
+			store.to_polyspan(paths[i], polyspan);
+			polyspan.sort_marks();
+			SwRender::polyspan(*surface, polyspan, paths[i].color, paths[i].evenodd, paths[i].invert);
+		}
+	}
+};
+
+
+class Cl2Renderer: public Renderer {
+private:
+	ClRender2 clr;
+
+public:
+	explicit Cl2Renderer(Environment &e): clr(e.cl()) { }
+
+	virtual void send_surface(Surface *surface)
+		{ clr.send_surface(surface); }
+	virtual Surface* receive_surface()
+		{ return clr.receive_surface(); }
+	virtual void draw()
+		{ clr.draw(); }
+
+	virtual void send_paths(const Path *paths, int count) {
+		vector<Contour> contours;
+		vector<ContourPath> transformed;
+		transform_contours(paths, count, contours, transformed);
+
+		vector<ClRender2::Path> cl_paths;
+		vector<ClRender2::Point> points;
+		cl_paths.reserve(count);
+		for(vector<ContourPath>::const_iterator i = transformed.begin(); i != transformed.end(); ++i) {
+			const Contour::ChunkList &chunks = i->contour->get_lod().get_chunks();
+			if (chunks.empty()) continue;
+
+			ClRender2::Path path = {};
+			path.color = i->color;
+			path.invert  = i->invert  ? -1 : 0;
+			path.evenodd = i->evenodd ? -1 : 0;
+			cl_paths.push_back(path);
+
+			int first_point_index = (int)points.size();
+			for(Contour::ChunkList::const_iterator j = chunks.begin(); j != chunks.end(); ++j) {
+				ClRender2::Point point = {};
+				point.coord = vec2f(j->p1);
+				point.path_index = (int)cl_paths.size() - 1;
+				points.push_back(point);
+			}
+			points.push_back(points[first_point_index]);
+		}
+
+		clr.remove_paths();
+		if (!cl_paths.empty())
+			clr.send_paths(&cl_paths.front(), (int)cl_paths.size(), &points.front(), (int)points.size());
+	}
+};
+
+
+class Cl3Renderer: public Renderer {
+private:
+	ClRender3 clr;
+	vector<ClRender3::Path> paths;
+	vector<affine2f> transforms;
+
+public:
+	explicit Cl3Renderer(Environment &e): clr(e.cl()) { }
+
+	virtual void send_surface(Surface *surface)
+		{ clr.send_surface(surface); }
+	virtual Surface* receive_surface()
+		{ return clr.receive_surface(); }
+
+	virtual void send_paths(const Path *paths, int count) {
+		PathStore store;
+		prepare_points(paths, count, (1024 - 1)/sizeof(vec2f) + 1, true, this->paths, transforms, store);
+		clr.send_points(store.get_points_data(), store.get_points_count());
+	}
+
+	virtual void draw() {
+		// points of instances are sent once, kernel applies transformation of every path
+		for(int i = 0; i < (int)paths.size(); ++i) {
+			clr.set_transform(transforms[i]);
+			clr.draw(paths[i]);
+		}
+		clr.set_transform(affine2f());
+	}
+};
+
+
+class HybridRenderer: public Renderer {
+private:
+	ThreadPool pool;
+	HybridRender hr;
+	Surface *surface;
+	vector<Contour> contours;
+	vector<ContourPath> paths;
+
+public:
+	explicit HybridRenderer(Environment &e): hr(e.cl(), pool), surface() { }
+
+	virtual void send_surface(Surface *surface)
+		{ this->surface = surface; hr.send_surface(surface); }
+	virtual Surface* receive_surface()
+		{ return surface; }
+	virtual void draw()
+		{ hr.draw(); }
+
+	virtual void send_paths(const Path *paths, int count) {
+		transform_contours(paths, count, contours, this->paths);
+		hr.send_paths(this->paths.empty() ? NULL : &this->paths.front(), count);
+	}
+};
+
+
+class ParallelRenderer: public Renderer {
+private:
+	ThreadPool pool;
+	ParallelRender pr;
+	vector<Contour> contours;
+	vector<ContourPath> paths;
+
+public:
+	explicit ParallelRenderer(Environment&): pr(pool) { }
+
+	virtual void send_surface(Surface *surface)
+		{ pr.send_surface(surface); }
+	virtual Surface* receive_surface()
+		{ return pr.receive_surface(); }
+	virtual void draw()
+		{ pr.draw(); }
+
+	virtual void send_paths(const Path *paths, int count) {
+		transform_contours(paths, count, contours, this->paths);
+		pr.send_paths(this->paths.empty() ? NULL : &this->paths.front(), count);
+	}
+};
+
+
+class BandRenderer: public Renderer {
+private:
+	BandRender br;
+	vector<Contour> contours;
+	vector<ContourPath> paths;
+
+public:
+	explicit BandRenderer(Environment&) { }
+
+	virtual void send_surface(Surface *surface)
+		{ br.send_surface(surface); }
+	virtual Surface* receive_surface()
+		{ return br.receive_surface(); }
+	virtual void draw()
+		{ br.draw(); }
+
+	virtual void send_paths(const Path *paths, int count) {
+		transform_contours(paths, count, contours, this->paths);
+		br.send_paths(this->paths.empty() ? NULL : &this->paths.front(), count);
+	}
+};
+
+
+class BatchRenderer: public Renderer {
+private:
+	BatchRender br;
+	vector<Contour> contours;
+	vector<ContourPath> paths;
+
+public:
+	explicit BatchRenderer(Environment&) { }
+
+	virtual void send_surface(Surface *surface)
+		{ br.send_surface(surface); }
+	virtual Surface* receive_surface()
+		{ return br.receive_surface(); }
+	virtual void draw()
+		{ br.draw(); }
+
+	virtual void send_paths(const Path *paths, int count) {
+		transform_contours(paths, count, contours, this->paths);
+		br.send_paths(this->paths.empty() ? NULL : &this->paths.front(), count);
+	}
+};
+
+
+// base for renderers which draw into framebuffer of GL context
+class GlSurfaceRenderer: public Renderer {
+protected:
+	GlContext &gl;
+	Surface *surface;
+
+public:
+	explicit GlSurfaceRenderer(Environment &e): gl(e.gl()), surface() { gl.use(); }
+
+	virtual void send_surface(Surface *surface) {
+		this->surface = surface;
+		if (surface) {
+			assert(surface->width == gl.width && surface->height == gl.height);
+			glBindTexture(GL_TEXTURE_2D, gl.texture_id);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, surface->width, surface->height, GL_RGBA, GL_FLOAT, surface->data);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+	}
+
+	virtual Surface* receive_surface() {
+		if (surface) {
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, gl.framebuffer_id);
+			glReadPixels(0, 0, surface->width, surface->height, GL_RGBA, GL_FLOAT, surface->data);
+		}
+		return surface;
+	}
+};
+
+
+class GlStencilRenderer: public GlSurfaceRenderer {
+private:
+	GlRender glr;
+	bool triangulate;
+	vector<Contour> contours;
+	vector<ContourPath> paths;
+
+public:
+	GlStencilRenderer(Environment &e, bool triangulate):
+		GlSurfaceRenderer(e), glr(e.shaders()), triangulate(triangulate) { }
+
+	virtual void draw()
+		{ glr.draw(); }
+
+	virtual void send_paths(const Path *paths, int count) {
+		transform_contours(paths, count, contours, this->paths);
+		glr.send_paths(this->paths.empty() ? NULL : &this->paths.front(), count, triangulate);
+	}
+};
+
+
+class GlComputeRenderer: public GlSurfaceRenderer {
+private:
+	GlComputeRender glr;
+	vector<GlComputeRender::Path> paths;
+	vector<affine2f> transforms;
+
+public:
+	explicit GlComputeRenderer(Environment &e):
+		GlSurfaceRenderer(e), glr(e.gl(), e.shaders()) { }
+
+	virtual void send_paths(const Path *paths, int count) {
+		PathStore store;
+		vector<ClRender3::Path> cl_paths;
+		prepare_points(paths, count, 1, true, cl_paths, transforms, store);
+
+		this->paths.clear();
+		this->paths.reserve(cl_paths.size());
+		for(vector<ClRender3::Path>::const_iterator i = cl_paths.begin(); i != cl_paths.end(); ++i) {
+			GlComputeRender::Path path;
+			path.bounds = recti(i->bounds.minx, i->bounds.miny, i->bounds.maxx, i->bounds.maxy);
+			path.begin = i->begin;
+			path.end = i->end;
+			path.color = i->color;
+			path.invert = i->invert;
+			path.evenodd = i->evenodd;
+			this->paths.push_back(path);
+		}
+		glr.send_points(store.get_points_data(), store.get_points_count());
+	}
+
+	virtual void draw() {
+		// points of instances are sent once, shader applies transformation of every path
+		for(int i = 0; i < (int)paths.size(); ++i) {
+			glr.set_transform(transforms[i]);
+			glr.draw(paths[i]);
+		}
+		glr.set_transform(affine2f());
+		glr.flush();
+	}
+};
+
+
+#ifdef CUDA
+class CudaRenderer: public Renderer {
+private:
+	CudaRender cur;
+	vector<CudaRender::Path> paths;
+
+public:
+	explicit CudaRenderer(Environment &e): cur(e.cu()) { }
+
+	virtual void send_surface(Surface *surface)
+		{ cur.send_surface(surface); }
+	virtual Surface* receive_surface()
+		{ return cur.receive_surface(); }
+
+	virtual void send_paths(const Path *paths, int count) {
+		// no transformation in kernel, so transformations are applied to points
+		PathStore store;
+		vector<ClRender3::Path> cl_paths;
+		vector<affine2f> transforms;
+		prepare_points(paths, count, 1, false, cl_paths, transforms, store);
+
+		this->paths.clear();
+		this->paths.reserve(cl_paths.size());
+		for(vector<ClRender3::Path>::const_iterator i = cl_paths.begin(); i != cl_paths.end(); ++i) {
+			CudaRender::Path path = {};
+			path.bounds = i->bounds;
+			path.begin = i->begin;
+			path.end = i->end;
+			path.color = i->color;
+			path.invert = i->invert;
+			path.evenodd = i->evenodd;
+			this->paths.push_back(path);
+		}
+		cur.send_points(store.get_points_data(), store.get_points_count());
+	}
+
+	virtual void draw() {
+		for(vector<CudaRender::Path>::const_iterator i = paths.begin(); i != paths.end(); ++i)
+			cur.draw(*i);
+	}
+};
+#endif
+
+
+Renderer* create_sw(Environment &e) { return new SwRenderer(e); }
+Renderer* create_cl2(Environment &e) { return new Cl2Renderer(e); }
+Renderer* create_cl3(Environment &e) { return new Cl3Renderer(e); }
+Renderer* create_hybrid(Environment &e) { return new HybridRenderer(e); }
+Renderer* create_sw_parallel(Environment &e) { return new ParallelRenderer(e); }
+Renderer* create_sw_band(Environment &e) { return new BandRenderer(e); }
+Renderer* create_sw_batch(Environment &e) { return new BatchRenderer(e); }
+Renderer* create_gl(Environment &e) { return new GlStencilRenderer(e, false); }
+Renderer* create_gl_triangles(Environment &e) { return new GlStencilRenderer(e, true); }
+Renderer* create_gl_compute(Environment &e) { return new GlComputeRenderer(e); }
+#ifdef CUDA
+Renderer* create_cu(Environment &e) { return new CudaRenderer(e); }
+#endif
+
+// built-in backends are registered at first use of registry
+map<string, Renderer::Factory>& get_factories() {
+	static map<string, Renderer::Factory> factories;
+	if (factories.empty()) {
+		factories["sw"] = &create_sw;
+		factories["cl2"] = &create_cl2;
+		factories["cl3"] = &create_cl3;
+		factories["hybrid"] = &create_hybrid;
+		factories["sw_parallel"] = &create_sw_parallel;
+		factories["sw_band"] = &create_sw_band;
+		factories["sw_batch"] = &create_sw_batch;
+		factories["gl"] = &create_gl;
+		factories["gl_triangles"] = &create_gl_triangles;
+		factories["gl_compute"] = &create_gl_compute;
+		#ifdef CUDA
+		factories["cu"] = &create_cu;
+		#endif
+	}
+	return factories;
+}
+
+} // namespace
+
+
+void Renderer::register_factory(const std::string &name, Factory factory) {
+	assert(factory);
+	get_factories()[name] = factory;
+}
+
+Renderer* Renderer::create(const std::string &name, Environment &e) {
+	map<string, Factory> &factories = get_factories();
+	map<string, Factory>::const_iterator i = factories.find(name);
+	return i == factories.end() ? NULL : i->second(e);
+}
+
+std::vector<std::string> Renderer::get_names() {
+	vector<string> names;
+	map<string, Factory> &factories = get_factories();
+	for(map<string, Factory>::const_iterator i = factories.begin(); i != factories.end(); ++i)
+		names.push_back(i->first);
+	return names;
+}
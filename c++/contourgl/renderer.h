@@ -0,0 +1,59 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _RENDERER_H_
+#define _RENDERER_H_
+
+#include <string>
+#include <vector>
+
+#include "contour.h"
+#include "environment.h"
+#include "swrender.h"
+
+
+// Common interface of rendering backends.
+// Backends are created by name from registry, contexts of environment
+// are requested by backend only, so they are created only when needed.
+class Renderer {
+public:
+	// instance of contour, many paths may refer to the same contour
+	struct Path: public ContourPath {
+		Affine transform;
+	};
+
+	typedef Renderer* (*Factory)(Environment &e);
+
+	virtual ~Renderer() { }
+
+	// target surface, its pixels are the background of frame
+	virtual void send_surface(Surface *surface) = 0;
+	// upload scene, coordinates of contours are in pixels after transformation of path,
+	// contours should stay alive while scene is used
+	virtual void send_paths(const Path *paths, int count) = 0;
+	// draw scene, maybe asynchronously
+	virtual void draw() = 0;
+	// wait for drawing and put pixels into the surface
+	virtual Surface* receive_surface() = 0;
+
+	static void register_factory(const std::string &name, Factory factory);
+	// returns NULL for unknown name
+	static Renderer* create(const std::string &name, Environment &e);
+	static std::vector<std::string> get_names();
+};
+
+#endif
@@ -0,0 +1,204 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <cassert>
+#include <climits>
+
+#include "scene.h"
+
+
+using namespace std;
+
+
+static bool rect_empty(const ContextRect &r)
+	{ return r.minx >= r.maxx || r.miny >= r.maxy; }
+
+static bool rect_intersects(const ContextRect &a, const ContextRect &b)
+	{ return a.minx < b.maxx && b.minx < a.maxx && a.miny < b.maxy && b.miny < a.maxy; }
+
+static ContextRect rect_merge(const ContextRect &a, const ContextRect &b) {
+	ContextRect r;
+	r.minx = min(a.minx, b.minx);
+	r.miny = min(a.miny, b.miny);
+	r.maxx = max(a.maxx, b.maxx);
+	r.maxy = max(a.maxy, b.maxy);
+	return r;
+}
+
+static long long rect_area(const ContextRect &r)
+	{ return (long long)(r.maxx - r.minx)*(long long)(r.maxy - r.miny); }
+
+
+Scene::Scene(int width, int height):
+	width(width), height(height), last_id()
+{
+	invalidate();
+}
+
+Scene::Item& Scene::get_item(int id) {
+	ItemMap::iterator i = items.find(id);
+	assert(i != items.end());
+	return i->second;
+}
+
+const Scene::Item& Scene::get(int id) const {
+	ItemMap::const_iterator i = items.find(id);
+	assert(i != items.end());
+	return i->second;
+}
+
+void Scene::update_bounds(Item &item) {
+	if (item.invert) {
+		item.bounds.minx = 0;
+		item.bounds.miny = 0;
+		item.bounds.maxx = width;
+		item.bounds.maxy = height;
+	} else
+	if (item.contour.get_chunks().empty()) {
+		item.bounds = ContextRect();
+	} else {
+		// one more pixel for antialiasing
+		Rect r = item.contour.get_bounds();
+		item.bounds.minx = (int)floor(r.p0.x) - 1;
+		item.bounds.miny = (int)floor(r.p0.y) - 1;
+		item.bounds.maxx = (int)floor(r.p1.x) + 2;
+		item.bounds.maxy = (int)floor(r.p1.y) + 2;
+	}
+}
+
+void Scene::changed(Item &item) {
+	// old bounds are dirty before change and new bounds after it
+	++item.revision;
+	invalidate(item.bounds);
+	update_bounds(item);
+	invalidate(item.bounds);
+}
+
+int Scene::add(const Contour &contour, const Color &color, bool invert, bool evenodd) {
+	int id = ++last_id;
+	Item &item = items[id];
+	item.contour = contour;
+	item.color = color;
+	item.invert = invert;
+	item.evenodd = evenodd;
+	changed(item);
+	return id;
+}
+
+void Scene::remove(int id) {
+	ItemMap::iterator i = items.find(id);
+	assert(i != items.end());
+	invalidate(i->second.bounds);
+	items.erase(i);
+}
+
+void Scene::clear() {
+	items.clear();
+	invalidate();
+}
+
+void Scene::set_contour(int id, const Contour &contour) {
+	Item &item = get_item(id);
+	item.contour = contour;
+	changed(item);
+}
+
+void Scene::set_color(int id, const Color &color) {
+	Item &item = get_item(id);
+	item.color = color;
+	changed(item);
+}
+
+void Scene::set_fill(int id, bool invert, bool evenodd) {
+	Item &item = get_item(id);
+	item.invert = invert;
+	item.evenodd = evenodd;
+	changed(item);
+}
+
+void Scene::transform(int id, const Affine &matrix) {
+	Item &item = get_item(id);
+	item.contour.transform(matrix);
+	changed(item);
+}
+
+void Scene::invalidate(const ContextRect &rect) {
+	ContextRect r;
+	r.minx = max(rect.minx, 0);
+	r.miny = max(rect.miny, 0);
+	r.maxx = min(rect.maxx, width);
+	r.maxy = min(rect.maxy, height);
+	if (rect_empty(r)) return;
+
+	// merge with all intersecting rectangles, merged rectangle may intersect other ones
+	for(bool merged = true; merged; ) {
+		merged = false;
+		for(vector<ContextRect>::iterator i = dirty.begin(); i != dirty.end(); ++i) {
+			if (rect_intersects(*i, r)) {
+				r = rect_merge(r, *i);
+				dirty.erase(i);
+				merged = true;
+				break;
+			}
+		}
+	}
+
+	if ((int)dirty.size() >= max_dirty_rects) {
+		// merge with rectangle which grows least
+		vector<ContextRect>::iterator best = dirty.begin();
+		long long best_growth = LLONG_MAX;
+		for(vector<ContextRect>::iterator i = dirty.begin(); i != dirty.end(); ++i) {
+			long long growth = rect_area(rect_merge(*i, r)) - rect_area(*i) - rect_area(r);
+			if (growth < best_growth) { best = i; best_growth = growth; }
+		}
+		r = rect_merge(r, *best);
+		dirty.erase(best);
+		invalidate(r);
+		return;
+	}
+
+	dirty.push_back(r);
+}
+
+void Scene::invalidate() {
+	dirty.clear();
+	ContextRect r;
+	r.maxx = width;
+	r.maxy = height;
+	invalidate(r);
+}
+
+int Scene::draw(Surface &surface) {
+	assert(surface.width == width && surface.height == height);
+
+	int count = 0;
+	for(vector<ContextRect>::const_iterator r = dirty.begin(); r != dirty.end(); ++r) {
+		SwRender::fill(surface, Color(), r->minx, r->miny, r->maxx - r->minx, r->maxy - r->miny);
+		for(ItemMap::const_iterator i = items.begin(); i != items.end(); ++i) {
+			const Item &item = i->second;
+			if (!rect_intersects(item.bounds, *r)) continue;
+			polyspan.init(*r);
+			item.contour.to_polyspan(polyspan);
+			polyspan.sort_marks();
+			SwRender::polyspan(surface, polyspan, item.color, item.evenodd, item.invert);
+			++count;
+		}
+	}
+	dirty.clear();
+	return count;
+}
@@ -0,0 +1,96 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef _SCENE_H_
+#define _SCENE_H_
+
+#include <map>
+#include <vector>
+
+#include "geometry.h"
+#include "contour.h"
+#include "polyspan.h"
+#include "swrender.h"
+
+
+// Retained set of contours drawn by software rasterizer.
+// Every change of contour marks its old and new bounds as dirty, and draw() repaints
+// only dirty rectangles of surface: they are cleared and contours which intersect them
+// are drawn again, clipped by window of polyspan.
+class Scene {
+public:
+	struct Item {
+		Contour contour;
+		Color color;
+		bool invert;
+		bool evenodd;
+		// bounds on surface, whole surface for inverted contours
+		ContextRect bounds;
+		// incremented on every change of item
+		int revision;
+
+		Item(): invert(), evenodd(), revision() { }
+	};
+
+	// ids are increasing, so items are drawn in order of map
+	typedef std::map<int, Item> ItemMap;
+
+	// when there are more dirty rectangles, nearest ones are merged
+	static const int max_dirty_rects = 16;
+
+private:
+	int width, height;
+	int last_id;
+	ItemMap items;
+	std::vector<ContextRect> dirty;
+	Polyspan polyspan;
+
+	Item& get_item(int id);
+	void update_bounds(Item &item);
+	void changed(Item &item);
+
+public:
+	Scene(int width, int height);
+
+	int get_width() const { return width; }
+	int get_height() const { return height; }
+
+	int add(const Contour &contour, const Color &color, bool invert = false, bool evenodd = false);
+	void remove(int id);
+	void clear();
+
+	void set_contour(int id, const Contour &contour);
+	void set_color(int id, const Color &color);
+	void set_fill(int id, bool invert, bool evenodd);
+	void transform(int id, const Affine &matrix);
+
+	const Item& get(int id) const;
+	const ItemMap& get_items() const { return items; }
+
+	// marks rectangle of surface to repaint
+	void invalidate(const ContextRect &rect);
+	// marks whole surface to repaint
+	void invalidate();
+	const std::vector<ContextRect>& get_dirty() const { return dirty; }
+
+	// repaints dirty rectangles of surface with the same size as scene,
+	// returns count of drawn contours
+	int draw(Surface &surface);
+};
+
+#endif
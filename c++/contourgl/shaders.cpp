@@ -30,10 +30,22 @@ Shaders::Shaders():
 	simpleProgramId(),
 	color_fragment_id(),
 	colorProgramId(),
-	colorUniform()
+	colorUniform(),
+	attrib_vertex_id(),
+	attrib_fragment_id(),
+	attribProgramId(),
+	attribFrameSizeUniform(),
+	compute_supported(),
+	compute_path_id(),
+	computePathProgramId(),
+	compute_fill_id(),
+	computeFillProgramId(),
+	compute_fill_hdr_id(),
+	computeFillHdrProgramId()
 {
 	// simple
 	const char *simpleVertexSource =
+		"#version 330\n"
 		"in vec2 position;\n"
 		"void main() { gl_Position = vec4(position, 0.0, 1.0); }\n";
 
@@ -50,9 +62,10 @@ Shaders::Shaders():
 
 	// color
 	const char *colorFragmentSource =
+		"#version 330\n"
 		"uniform vec4 color;\n"
-		//"out vec4 colorOut;\n"
-		"void main() { gl_FragColor = color; }\n";
+		"out vec4 colorOut;\n"
+		"void main() { colorOut = color; }\n";
 
 	color_fragment_id = glCreateShader(GL_FRAGMENT_SHADER);
 	glShaderSource(color_fragment_id, 1, &colorFragmentSource, NULL);
@@ -63,16 +76,192 @@ Shaders::Shaders():
 	glAttachShader(colorProgramId, simple_vertex_id);
 	glAttachShader(colorProgramId, color_fragment_id);
 	glBindAttribLocation(colorProgramId, 0, "position");
-	//glBindFragDataLocation(color_program_id, 0, "colorOut");
+	glBindFragDataLocation(colorProgramId, 0, "colorOut");
 	glLinkProgram(colorProgramId);
 	check_program(colorProgramId, "color");
 	colorUniform = glGetUniformLocation(colorProgramId, "color");
+
+	// attrib
+	const char *attribVertexSource =
+		"#version 330\n"
+		"uniform vec2 frameSize;\n"
+		"in vec2 position;\n"
+		"in vec4 color;\n"
+		"out vec4 vertexColor;\n"
+		"void main() {\n"
+		"  gl_Position = vec4(position*2.0/frameSize - 1.0, 0.0, 1.0);\n"
+		"  vertexColor = color;\n"
+		"}\n";
+
+	attrib_vertex_id = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(attrib_vertex_id, 1, &attribVertexSource, NULL);
+	glCompileShader(attrib_vertex_id);
+	check_shader(attrib_vertex_id, attribVertexSource);
+
+	const char *attribFragmentSource =
+		"#version 330\n"
+		"in vec4 vertexColor;\n"
+		"out vec4 colorOut;\n"
+		"void main() { colorOut = vertexColor; }\n";
+
+	attrib_fragment_id = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(attrib_fragment_id, 1, &attribFragmentSource, NULL);
+	glCompileShader(attrib_fragment_id);
+	check_shader(attrib_fragment_id, attribFragmentSource);
+
+	attribProgramId = glCreateProgram();
+	glAttachShader(attribProgramId, attrib_vertex_id);
+	glAttachShader(attribProgramId, attrib_fragment_id);
+	glBindAttribLocation(attribProgramId, 0, "position");
+	glBindAttribLocation(attribProgramId, 1, "color");
+	glBindFragDataLocation(attribProgramId, 0, "colorOut");
+	glLinkProgram(attribProgramId);
+	check_program(attribProgramId, "attrib");
+	attribFrameSizeUniform = glGetUniformLocation(attribProgramId, "frameSize");
+
+	// compute
+
+	GLint major_version = 0, minor_version = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+	glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+	compute_supported = major_version > 4 || (major_version == 4 && minor_version >= 3);
+	if (!compute_supported) return;
+
+	// path
+	// marks are pairs of integers: area multiplied by cover, and cover
+	const char *computePathSource =
+		"#version 430\n"
+		"layout(local_size_x = 64) in;\n"
+		"layout(std430, binding = 0) buffer Marks { int marks[]; };\n"
+		"layout(std430, binding = 1) readonly buffer Points { vec2 points[]; };\n"
+		"layout(location = 0) uniform ivec2 frameSize;\n"
+		"layout(location = 1) uniform int begin;\n"
+		"layout(location = 2) uniform int end;\n"
+		"layout(location = 3) uniform vec2 axisX;\n"
+		"layout(location = 4) uniform vec2 axisY;\n"
+		"layout(location = 5) uniform vec2 offset;\n"
+		"const float ONE_F = 65536.0;\n"
+		"void main() {\n"
+		"  int id = begin + int(gl_GlobalInvocationID.x);\n"
+		"  if (id >= end) return;\n"
+		"  vec2 p0 = axisX*points[id].x + axisY*points[id].y + offset;\n"
+		"  vec2 p1 = axisX*points[id + 1].x + axisY*points[id + 1].y + offset;\n"
+		"  bool flipx = p1.x < p0.x;\n"
+		"  bool flipy = p1.y < p0.y;\n"
+		"  if (flipx) { p0.x = float(frameSize.x) - p0.x; p1.x = float(frameSize.x) - p1.x; }\n"
+		"  if (flipy) { p0.y = float(frameSize.y) - p0.y; p1.y = float(frameSize.y) - p1.y; }\n"
+		"  vec2 d = p1 - p0;\n"
+		"  int w1 = frameSize.x - 1;\n"
+		"  int h1 = frameSize.y - 1;\n"
+		"  float kx = d.x/d.y;\n"
+		"  float ky = d.y/d.x;\n"
+		// columns are independent, so just cut part at the left of frame
+		"  if (p1.x <= 0.0) return;\n"
+		"  if (p0.x < 0.0) { p0.y = min(p0.y - ky*p0.x, p1.y); p0.x = 0.0; }\n"
+		"  while(p0.x != p1.x || p0.y != p1.y) {\n"
+		"    int ix = int(p0.x);\n"
+		"    int iy = int(floor(p0.y));\n"
+		"    if (ix > w1) return;\n"
+		"    vec2 px, py;\n"
+		"    px.x = float(ix + 1);\n"
+		"    py.y = float(iy + 1);\n"
+		"    bool below = flipy ? iy < 0 : iy > h1;\n"
+		"    bool above = flipy ? iy > h1 : iy < 0;\n"
+		"    iy = clamp(iy, 0, h1);\n"
+		"    px.y = p0.y + ky*(px.x - p0.x);\n"
+		"    py.x = p0.x + kx*(py.y - p0.y);\n"
+		"    vec2 pp1 = p1;\n"
+		"    if (pp1.x > px.x) pp1 = px;\n"
+		"    if (pp1.y > py.y) pp1 = py;\n"
+		"    float cover = (pp1.x - p0.x)*ONE_F;\n"
+		"    float area = py.y - 0.5*(p0.y + pp1.y);\n"
+		"    if (flipx) { ix = w1 - ix; cover = -cover; }\n"
+		"    if (flipy) { iy = h1 - iy; area = 1.0 - area; }\n"
+		// rows above the frame fully cover the first row
+		"    if (above) area = 1.0;\n"
+		"    p0 = pp1;\n"
+		"    if (!below) {\n"
+		"      int i = 2*(iy*frameSize.x + ix);\n"
+		"      atomicAdd(marks[i], int(area*cover));\n"
+		"      atomicAdd(marks[i + 1], int(cover));\n"
+		"    }\n"
+		"  }\n"
+		"}\n";
+
+	compute_path_id = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(compute_path_id, 1, &computePathSource, NULL);
+	glCompileShader(compute_path_id);
+	check_shader(compute_path_id, computePathSource);
+
+	computePathProgramId = glCreateProgram();
+	glAttachShader(computePathProgramId, compute_path_id);
+	glLinkProgram(computePathProgramId);
+	check_program(computePathProgramId, "compute path");
+
+	// fill
+	// reads marks column by column and resets them back to zero,
+	// format of image should match to texture, so there are two programs
+	const char *computeFillSources[] = {
+		"#version 430\n"
+		"layout(rgba8, binding = 0) uniform image2D image;\n",
+		"#version 430\n"
+		"layout(rgba16f, binding = 0) uniform image2D image;\n",
+		"layout(local_size_x = 16) in;\n"
+		"layout(std430, binding = 0) buffer Marks { int marks[]; };\n"
+		"layout(location = 0) uniform int width;\n"
+		"layout(location = 1) uniform ivec4 bounds;\n"
+		"layout(location = 2) uniform vec4 color;\n"
+		"layout(location = 3) uniform bool evenodd;\n"
+		"layout(location = 4) uniform bool invert;\n"
+		"void main() {\n"
+		"  int x = bounds.x + int(gl_GlobalInvocationID.x);\n"
+		"  if (x >= bounds.z) return;\n"
+		"  int icover = 0;\n"
+		"  for(int y = bounds.y; y < bounds.w; ++y) {\n"
+		"    int i = 2*(y*width + x);\n"
+		"    int cover = abs(marks[i] + icover);\n"
+		"    icover += marks[i + 1];\n"
+		"    marks[i] = 0;\n"
+		"    marks[i + 1] = 0;\n"
+		"    if (evenodd) { cover &= 131071; if (cover > 65536) cover = 131072 - cover; }\n"
+		"    float alpha = float(min(cover, 65536))/65536.0;\n"
+		"    if (invert) alpha = 1.0 - alpha;\n"
+		"    alpha *= color.a;\n"
+		"    ivec2 p = ivec2(x, y);\n"
+		"    imageStore(image, p, imageLoad(image, p)*(1.0 - alpha) + color*alpha);\n"
+		"  }\n"
+		"}\n" };
+
+	for(int hdr = 0; hdr < 2; ++hdr) {
+		GLuint &shader_id = hdr ? compute_fill_hdr_id : compute_fill_id;
+		GLuint &program_id = hdr ? computeFillHdrProgramId : computeFillProgramId;
+		const char *sources[] = { computeFillSources[hdr], computeFillSources[2] };
+
+		shader_id = glCreateShader(GL_COMPUTE_SHADER);
+		glShaderSource(shader_id, 2, sources, NULL);
+		glCompileShader(shader_id);
+		check_shader(shader_id, computeFillSources[2]);
+
+		program_id = glCreateProgram();
+		glAttachShader(program_id, shader_id);
+		glLinkProgram(program_id);
+		check_program(program_id, hdr ? "compute fill hdr" : "compute fill");
+	}
 }
 
 Shaders::~Shaders() {
 	glUseProgram(0);
+	glDeleteProgram(computeFillHdrProgramId);
+	glDeleteProgram(computeFillProgramId);
+	glDeleteProgram(computePathProgramId);
+	glDeleteShader(compute_fill_hdr_id);
+	glDeleteShader(compute_fill_id);
+	glDeleteShader(compute_path_id);
+	glDeleteProgram(attribProgramId);
 	glDeleteProgram(colorProgramId);
 	glDeleteProgram(simpleProgramId);
+	glDeleteShader(attrib_fragment_id);
+	glDeleteShader(attrib_vertex_id);
 	glDeleteShader(color_fragment_id);
 	glDeleteShader(simple_vertex_id);
 }
@@ -146,3 +335,27 @@ void Shaders::color(const Color &c) {
 }
 
 
+
+void Shaders::attrib(const vec2f &frame_size) {
+	glUseProgram(attribProgramId);
+	glUniform2fv(attribFrameSizeUniform, 1, frame_size.coords);
+}
+
+void Shaders::compute_path(const vec2i &frame_size, int begin, int end, const affine2f &transform) {
+	glUseProgram(computePathProgramId);
+	glUniform2iv(0, 1, frame_size.coords);
+	glUniform1i(1, begin);
+	glUniform1i(2, end);
+	glUniform2fv(3, 1, transform.axis_x.coords);
+	glUniform2fv(4, 1, transform.axis_y.coords);
+	glUniform2fv(5, 1, transform.offset.coords);
+}
+
+void Shaders::compute_fill(bool hdr, int width, const recti &bounds, const Color &color, bool evenodd, bool invert) {
+	glUseProgram(hdr ? computeFillHdrProgramId : computeFillProgramId);
+	glUniform1i(0, width);
+	glUniform4i(1, bounds.p0.x, bounds.p0.y, bounds.p1.x, bounds.p1.y);
+	glUniform4fv(2, 1, color.channels);
+	glUniform1i(3, evenodd);
+	glUniform1i(4, invert);
+}
@@ -33,6 +33,22 @@ public:
 	GLuint colorProgramId;
 	GLint colorUniform;
 
+	GLuint attrib_vertex_id;
+	GLuint attrib_fragment_id;
+	GLuint attribProgramId;
+	GLint attribFrameSizeUniform;
+
+	// compute shaders available since GL 4.3 only, zero ids otherwise
+	bool compute_supported;
+
+	GLuint compute_path_id;
+	GLuint computePathProgramId;
+
+	GLuint compute_fill_id;
+	GLuint computeFillProgramId;
+	GLuint compute_fill_hdr_id;
+	GLuint computeFillHdrProgramId;
+
 	void check_shader(GLuint id, const char *src);
 	void check_program(GLuint id, const char *name);
 
@@ -41,6 +57,14 @@ public:
 
 	void simple();
 	void color(const Color &c);
+	// positions in pixels and color from vertex attribute 1
+	void attrib(const vec2f &frame_size);
+
+	// port of path and fill kernels from contour-base.cl,
+	// marks are in shader storage buffer binding 0, points in binding 1,
+	// target texture is image unit 0
+	void compute_path(const vec2i &frame_size, int begin, int end, const affine2f &transform);
+	void compute_fill(bool hdr, int width, const recti &bounds, const Color &color, bool evenodd, bool invert);
 };
 
 #endif
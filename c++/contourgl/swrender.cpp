@@ -15,12 +15,78 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <cassert>
+
+#include <algorithm>
+
 #include "swrender.h"
 
 
 using namespace std;
 
 
+namespace {
+	// edge of convex polygon
+	struct ConvexEdge {
+		Vector p0, p1;
+		Real top, bottom;
+		ConvexEdge(): top(), bottom() { }
+		ConvexEdge(const Vector &p0, const Vector &p1):
+			p0(p0), p1(p1), top(min(p0.y, p1.y)), bottom(max(p0.y, p1.y)) { }
+		bool operator< (const ConvexEdge &other) const
+			{ return top < other.top; }
+		Real x(Real y) const
+			{ return y == p0.y ? p0.x : y == p1.y ? p1.x : p0.x + (y - p0.y)*(p1.x - p0.x)/(p1.y - p0.y); }
+	};
+}
+
+// adds cover and area of line inside one scanline (y1 and y2 are in [0, 1]) into dense cells,
+// like Polyspan::draw_scanline does
+static void add_cells(Real *covers, Real *areas, Real x1, Real y1, Real x2, Real y2) {
+	int ix1 = (int)floor(x1);
+	int ix2 = (int)floor(x2);
+	Real fx1 = x1 - ix1;
+	Real fx2 = x2 - ix2;
+	Real dx = x2 - x1;
+	Real dy = y2 - y1;
+
+	// all in same pixel
+	if (ix1 == ix2) {
+		covers[ix1] += dy;
+		areas[ix1] += (fx1 + fx2)*dy/2;
+		return;
+	}
+
+	if (dx > 0) {
+		Real dydx = dy/dx;
+		Real mult = (1 - fx1)*dydx;
+		covers[ix1] += mult;
+		areas[ix1] += (1 + fx1)*mult/2;
+		for(++ix1; ix1 != ix2; ++ix1) {
+			covers[ix1] += dydx;
+			areas[ix1] += dydx/2;
+		}
+		mult = fx2*dydx;
+		covers[ix2] += mult;
+		areas[ix2] += fx2*mult/2;
+	} else {
+		Real dydx = -dy/dx;
+		Real mult = fx1*dydx;
+		covers[ix1] += mult;
+		areas[ix1] += fx1*mult/2;
+		y1 += mult;
+		for(--ix1; ix1 != ix2; --ix1) {
+			covers[ix1] += dydx;
+			areas[ix1] += dydx/2;
+			y1 += dydx;
+		}
+		mult = y2 - y1;
+		covers[ix2] += mult;
+		areas[ix2] += (fx2 + 1)*mult/2;
+	}
+}
+
+
 void SwRender::fill(
 	Surface &target,
 	const Color &color )
@@ -77,105 +143,110 @@ void SwRender::polyspan(
 	bool evenodd,
 	bool invert )
 {
-	const ContextRect &window = polyspan.get_window();
-	const Polyspan::cover_array &covers = polyspan.get_covers();
-
-	Polyspan::cover_array::const_iterator cur_mark = covers.begin();
-	Polyspan::cover_array::const_iterator end_mark = covers.end();
-
-	Real cover = 0, area = 0, alpha = 0;
-	int	y = 0, x = 0;
+	Blend blend(target, color);
+	walk(polyspan, evenodd, invert, blend);
+}
 
-	if (cur_mark == end_mark) {
-		// no marks at all
-		if (invert)
-			fill( target, color,
-				  window.minx, window.miny,
-				  window.maxx - window.minx, window.maxy - window.miny );
-		return;
+void SwRender::rect(
+	Surface &target,
+	const Rect &rect,
+	const Color &color )
+{
+	Real x0 = rect.p0.x, y0 = rect.p0.y;
+	Real x1 = rect.p1.x, y1 = rect.p1.y;
+	if (!(x0 < x1) || !(y0 < y1)) return;
+	assert(x0 >= 0 && y0 >= 0 && x1 <= target.width && y1 <= target.height);
+
+	// first and last pixels covered partially
+	int left = (int)floor(x0), right = (int)ceil(x1) - 1;
+	int top = (int)floor(y0), bottom = (int)ceil(y1) - 1;
+	Real cover_left = left == right ? x1 - x0 : left + 1 - x0;
+	Real cover_right = x1 - right;
+	Real cover_top = top == bottom ? y1 - y0 : top + 1 - y0;
+	Real cover_bottom = y1 - bottom;
+
+	// inner area is just filled
+	if (right - left > 1 && bottom - top > 1)
+		fill(target, color, left + 1, top + 1, right - left - 1, bottom - top - 1);
+
+	// antialiased edges
+	Blend blend(target, color);
+	for(int y = top; y <= bottom; ++y) {
+		Real cover = y == top ? cover_top : y == bottom ? cover_bottom : 1.0;
+		blend(left, y, 1, cover_left*cover);
+		if (right != left)
+			blend(right, y, 1, cover_right*cover);
+		if ((y == top || y == bottom) && right - left > 1)
+			blend(left + 1, y, right - left - 1, cover);
 	}
+}
 
-	// fill initial rect / line
-	if (invert) {
-		// fill all the area above the first vertex
-		y = window.miny;
-		int l = window.maxx - window.minx;
-
-		fill( target, color,
-			  window.minx, window.miny,
-			  l, cur_mark->y - window.miny );
-
-		// fill the area to the left of the first vertex on that line
-		l = cur_mark->x - window.minx;
-		if (l)
-			row(target, color, window.minx, cur_mark->y, l);
+void SwRender::convex(
+	Surface &target,
+	const std::vector<Vector> &points,
+	const Color &color )
+{
+	int count = (int)points.size();
+	if (count < 3) return;
+
+	Rect bounds(points.front(), points.front());
+	vector<ConvexEdge> edges;
+	for(int i = 0; i < count; ++i) {
+		const Vector &p0 = points[i], &p1 = points[(i + 1)%count];
+		bounds = bounds.expand(p0);
+		if (p0.y != p1.y) edges.push_back(ConvexEdge(p0, p1));
 	}
-
-	while(true) {
-		y = cur_mark->y;
-		x = cur_mark->x;
-
-		area = cur_mark->area;
-		cover += cur_mark->cover;
-
-		// accumulate for the current pixel
-		while(++cur_mark != covers.end()) {
-			if (y != cur_mark->y || x != cur_mark->x)
-				break;
-			area += cur_mark->area;
-			cover += cur_mark->cover;
+	assert(bounds.p0.x >= 0 && bounds.p0.y >= 0 && bounds.p1.x <= target.width && bounds.p1.y <= target.height);
+	if (edges.empty()) return;
+	sort(edges.begin(), edges.end());
+
+	// cells of one scanline
+	int minx = (int)floor(bounds.p0.x);
+	int miny = (int)floor(bounds.p0.y);
+	int maxy = (int)ceil(bounds.p1.y);
+	vector<Real> covers((int)floor(bounds.p1.x) - minx + 2);
+	vector<Real> areas(covers.size());
+	vector<ConvexEdge> active;
+	vector< pair<int, int> > ranges;
+	Blend blend(target, color);
+
+	vector<ConvexEdge>::const_iterator next = edges.begin();
+	for(int y = miny; y < maxy; ++y) {
+		while(next != edges.end() && next->top < y + 1)
+			active.push_back(*next++);
+
+		// add parts of edges inside of scanline
+		ranges.clear();
+		int index = 0;
+		for(vector<ConvexEdge>::const_iterator i = active.begin(); i != active.end(); ++i) {
+			if (i->bottom <= y) continue;
+			active[index++] = *i;
+
+			Real ya = max(i->top, (Real)y), yb = min(i->bottom, (Real)(y + 1));
+			if (i->p0.y > i->p1.y) swap(ya, yb);
+			Real xa = i->x(ya) - minx, xb = i->x(yb) - minx;
+			add_cells(&covers.front(), &areas.front(), xa, ya - y, xb, yb - y);
+			ranges.push_back(pair<int, int>((int)floor(min(xa, xb)), (int)floor(max(xa, xb))));
 		}
-
-		// draw pixel - based on covered area
-		if (area) { // if we're ok, draw the current pixel
-			alpha = polyspan.extract_alpha(cover - area, evenodd);
-			if (invert) alpha = 1 - alpha;
-			if (alpha) {
-				Color::type a = (Color::type)alpha;
-				Color &c = target[y][x];
-				c.r = c.r*(1.f - a) + color.r*a;
-				c.g = c.g*(1.f - a) + color.g*a;
-				c.b = c.b*(1.f - a) + color.b*a;
-				c.a = c.a*(1.f - a) + color.a*a;
+		active.resize(index);
+		if (ranges.empty()) continue;
+
+		// draw cells of edges and spans between them, like SwRender::walk
+		sort(ranges.begin(), ranges.end());
+		Real cover = 0;
+		int x = ranges.front().first;
+		for(vector< pair<int, int> >::const_iterator i = ranges.begin(); i != ranges.end(); ++i) {
+			if (x < i->first) {
+				Real alpha = Polyspan::extract_alpha(cover, false);
+				if (alpha) blend(minx + x, y, i->first - x, alpha);
+				x = i->first;
 			}
-			++x;
-		}
-
-		// if we're done, don't use iterator and exit
-		if (cur_mark == end_mark)
-			break;
-
-		// if there is no more live pixels on this line, goto next
-		if (y != cur_mark->y) {
-			if (invert) {
-				// fill the area at the end of the line
-				row(target, color, x, y, window.maxx - x);
-
-				// fill area at the beginning of the next line
-				row(target, color, window.minx, cur_mark->y, cur_mark->x - window.minx);
+			for(; x <= i->second; ++x) {
+				cover += covers[x];
+				Real alpha = Polyspan::extract_alpha(cover - areas[x], false);
+				if (alpha) blend(minx + x, y, 1, alpha);
+				covers[x] = areas[x] = 0;
 			}
-
-			cover = 0;
-			continue;
 		}
-
-		// draw span to next pixel - based on total amount of pixel cover
-		if (x < cur_mark->x) {
-			alpha = polyspan.extract_alpha(cover, evenodd);
-			if (invert) alpha = 1.0 - alpha;
-			if (alpha)
-				row_alpha(target, color, alpha, x, y, cur_mark->x - x);
-		}
-	}
-
-	// fill the after stuff
-	if (invert) {
-		// fill the area at the end of the line
-		row(target, color, x, y, window.maxx - x);
-
-		// fill area at the beginning of the next line
-		fill( target, color,
-			  window.minx, y+1,
-			  window.maxx - window.minx, window.maxy - y - 1 );
 	}
 }
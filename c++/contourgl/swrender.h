@@ -20,8 +20,12 @@
 
 #include <cstring>
 
+#include <vector>
+
 #include "polyspan.h"
 
+class Contour;
+
 class Color {
 public:
 	typedef float type;
@@ -35,6 +39,14 @@ public:
 	Color(const Color &color, type a): r(color.r), g(color.g), b(color.b), a(color.a*a) { }
 };
 
+// filled contour, common path type of renderers which take contours
+struct ContourPath {
+	const Contour *contour;
+	Color color;
+	bool invert;
+	bool evenodd;
+};
+
 class Surface {
 public:
 	const int width, height;
@@ -83,12 +95,141 @@ public:
 		int top,
 		int length );
 
+	// blends spans of walk() into surface, fully covered spans are just stored
+	class Blend {
+	private:
+		Surface &target;
+		const Color &color;
+	public:
+		Blend(Surface &target, const Color &color): target(target), color(color) { }
+		void operator() (int x, int y, int length, Real alpha) {
+			if (alpha == 1.0)
+				row(target, color, x, y, length);
+			else
+				row_alpha(target, color, (Color::type)alpha, x, y, length);
+		}
+	};
+
+	// calls target(x, y, length, alpha) for covered pixels and spans of polyspan,
+	// areas of inverted polyspan outside of marks are passed with alpha 1
+	template<typename T>
+	static void walk(const Polyspan &polyspan, bool evenodd, bool invert, T &target) {
+		const ContextRect &window = polyspan.get_window();
+		const Polyspan::cover_array &covers = polyspan.get_covers();
+
+		Polyspan::cover_array::const_iterator cur_mark = covers.begin();
+		Polyspan::cover_array::const_iterator end_mark = covers.end();
+
+		Real cover = 0, area = 0, alpha = 0;
+		int	y = 0, x = 0;
+
+		if (cur_mark == end_mark) {
+			// no marks at all
+			if (invert)
+				for(int yy = window.miny; yy < window.maxy; ++yy)
+					target(window.minx, yy, window.maxx - window.minx, 1.0);
+			return;
+		}
+
+		// fill initial rect / line
+		if (invert) {
+			// fill all the area above the first vertex
+			for(int yy = window.miny; yy < cur_mark->y; ++yy)
+				target(window.minx, yy, window.maxx - window.minx, 1.0);
+
+			// fill the area to the left of the first vertex on that line
+			if (cur_mark->x > window.minx)
+				target(window.minx, cur_mark->y, cur_mark->x - window.minx, 1.0);
+		}
+
+		while(true) {
+			y = cur_mark->y;
+			x = cur_mark->x;
+
+			area = cur_mark->area;
+			cover += cur_mark->cover;
+
+			// accumulate for the current pixel
+			while(++cur_mark != end_mark) {
+				if (y != cur_mark->y || x != cur_mark->x)
+					break;
+				area += cur_mark->area;
+				cover += cur_mark->cover;
+			}
+
+			// draw pixel - based on covered area
+			if (area) { // if we're ok, draw the current pixel
+				alpha = polyspan.extract_alpha(cover - area, evenodd);
+				if (invert) alpha = 1 - alpha;
+				if (alpha)
+					target(x, y, 1, alpha);
+				++x;
+			}
+
+			// if we're done, don't use iterator and exit
+			if (cur_mark == end_mark)
+				break;
+
+			// if there is no more live pixels on this line, goto next
+			if (y != cur_mark->y) {
+				if (invert) {
+					// fill the area at the end of the line
+					if (window.maxx > x)
+						target(x, y, window.maxx - x, 1.0);
+
+					// fill empty lines between marks, e.g. between separate subpaths
+					for(int yy = y + 1; yy < cur_mark->y; ++yy)
+						target(window.minx, yy, window.maxx - window.minx, 1.0);
+
+					// fill area at the beginning of the next line
+					if (cur_mark->x > window.minx)
+						target(window.minx, cur_mark->y, cur_mark->x - window.minx, 1.0);
+				}
+
+				cover = 0;
+				continue;
+			}
+
+			// draw span to next pixel - based on total amount of pixel cover
+			if (x < cur_mark->x) {
+				alpha = polyspan.extract_alpha(cover, evenodd);
+				if (invert) alpha = 1.0 - alpha;
+				if (alpha)
+					target(x, y, cur_mark->x - x, alpha);
+			}
+		}
+
+		// fill the after stuff
+		if (invert) {
+			// fill the area at the end of the line
+			if (window.maxx > x)
+				target(x, y, window.maxx - x, 1.0);
+
+			// fill area at the beginning of the next line
+			for(int yy = y + 1; yy < window.maxy; ++yy)
+				target(window.minx, yy, window.maxx - window.minx, 1.0);
+		}
+	}
+
 	static void polyspan(
 		Surface &target,
 		const Polyspan &polyspan,
 		const Color &color,
 		bool evenodd,
 		bool invert );
+
+	// fills rectangle with antialiased edges, rectangle should be inside of target
+	static void rect(
+		Surface &target,
+		const Rect &rect,
+		const Color &color );
+
+	// fills convex polygon with antialiased edges scanline by scanline without sorting of cells,
+	// polygon should be inside of target
+	static void convex(
+		Surface &target,
+		const std::vector<Vector> &points,
+		const Color &color );
 };
 
 #endif
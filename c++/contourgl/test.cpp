@@ -18,13 +18,28 @@
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <atomic>
+#include <limits>
 
 #include "test.h"
 #include "contourbuilder.h"
 #include "triangulator.h"
+#include "glrender.h"
+#include "glreadback.h"
 #include "measure.h"
 #include "utils.h"
 #include "clrender.h"
+#include "bandrender.h"
+#include "batchrender.h"
+#include "hybridrender.h"
+#include "parallelraster.h"
+#include "parallelrender.h"
+#include "renderer.h"
+#include "scene.h"
+#include "contourraster.h"
+#include "bvh.h"
+#include "occlusion.h"
+#include "threadpool.h"
 
 #ifdef CUDA
 #include "cudarender.h"
@@ -56,7 +71,7 @@ void Test::draw_contour(
 		glStencilOpSeparate(GL_FRONT, GL_INCR_WRAP, GL_INCR_WRAP, GL_INCR_WRAP);
 		glStencilOpSeparate(GL_BACK, GL_DECR_WRAP, GL_DECR_WRAP, GL_DECR_WRAP);
 	}
-	e.shaders.simple();
+	e.shaders().simple();
 	glDrawArrays(GL_TRIANGLE_FAN, start, count);
 	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
 
@@ -71,7 +86,7 @@ void Test::draw_contour(
 	if ( even_odd &&  invert)
 		glStencilFunc(GL_EQUAL, 0, 1);
 
-	e.shaders.color(color);
+	e.shaders().color(color);
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
 	glDisable(GL_STENCIL_TEST);
@@ -158,11 +173,68 @@ void Test::transform(Data &data, const Rect &from, const Rect &to) {
 		i->contour.transform(from, to);
 }
 
+// contours are taken by threads one by one
+class ContoursTask: public ThreadPool::Task {
+private:
+	int count;
+	std::atomic<int> next;
+protected:
+	virtual void process(int index) = 0;
+public:
+	explicit ContoursTask(int count): count(count), next() { }
+	virtual void run(int, int) {
+		for(int i = next++; i < count; i = next++)
+			process(i);
+	}
+};
+
+class DowngradeTask: public ContoursTask {
+private:
+	Test::Data &from;
+	Test::Data &to;
+	Real tolerance;
+protected:
+	virtual void process(int index)
+		{ from[index].contour.downgrade(to[index].contour, tolerance); }
+public:
+	DowngradeTask(Test::Data &from, Test::Data &to, Real tolerance):
+		ContoursTask((int)from.size()), from(from), to(to), tolerance(tolerance) { }
+};
+
+class BuildLodTask: public ContoursTask {
+private:
+	Test::Data &data;
+protected:
+	virtual void process(int index)
+		{ data[index].contour.build_lod(); }
+public:
+	explicit BuildLodTask(Test::Data &data):
+		ContoursTask((int)data.size()), data(data) { }
+};
+
 void Test::downgrade(Data &from, Data &to) {
 	to = from;
+	ThreadPool pool;
 	Measure t("downgrade");
-	for(Data::iterator i = from.begin(); i != from.end(); ++i)
-		i->contour.downgrade(to[i - from.begin()].contour, Vector(1.f, 1.f));
+	DowngradeTask task(from, to, 0.5);
+	pool.run(task);
+
+	int vertices_count = 0;
+	for(Data::const_iterator i = to.begin(); i != to.end(); ++i)
+		vertices_count += (int)i->contour.get_chunks().size();
+	cout << vertices_count << " vertices after downgrade" << endl;
+}
+
+void Test::build_lod(Data &data) {
+	ThreadPool pool;
+	Measure t("build_lod");
+	BuildLodTask task(data);
+	pool.run(task);
+
+	int levels_count = 0;
+	for(Data::const_iterator i = data.begin(); i != data.end(); ++i)
+		levels_count += i->contour.get_lod_count();
+	cout << levels_count << " levels of detail" << endl;
 }
 
 void Test::split(Data &from, Data &to) {
@@ -173,6 +245,7 @@ void Test::split(Data &from, Data &to) {
 }
 
 void Test::test_gl_stencil(Environment &e, Data &data) {
+	e.use();
 	Vector size = Utils::get_frame_size();
 	GLuint buffer_id = 0;
 	GLuint array_id = 0;
@@ -213,14 +286,14 @@ void Test::test_gl_stencil(Environment &e, Data &data) {
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_TRUE, 0, NULL);
 
-	e.shaders.color(Color(0.f, 0.f, 1.f, 1.f));
+	e.shaders().color(Color(0.f, 0.f, 1.f, 1.f));
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, vertices.size());
 	glFinish();
 	glClear(GL_COLOR_BUFFER_BIT);
 	glFinish();
 
 	{
-		Measure t("render");
+		Measure t("render", false, false, true);
 		for(int i = 0; i < (int)data.size(); ++i) {
 			draw_contour(
 				e,
@@ -231,7 +304,109 @@ void Test::test_gl_stencil(Environment &e, Data &data) {
 				data[i].evenodd,
 				data[i].color );
 		}
-		glFinish();
+	}
+}
+
+void Test::test_gl_batch(Environment &e, Data &data, bool triangulate) {
+	vector<GlRender::Path> paths;
+	prepare_paths(data, paths);
+
+	GlRender glr(e.shaders());
+	{
+		Measure t("send paths");
+		glr.send_paths(&paths.front(), (int)paths.size(), triangulate);
+	}
+
+	// warm-up
+	glr.draw();
+	glFinish();
+	glClear(GL_COLOR_BUFFER_BIT);
+	glFinish();
+
+	{
+		Measure t("render", false, false, true);
+		glr.draw();
+	}
+	cout << "gl batch: " << paths.size() << " contours in " << glr.get_batches_count() << " batches"
+		 << (triangulate ? " (triangulated)" : "") << endl;
+}
+
+void Test::test_gl_compute(Environment &e, Data &data) {
+	if (!e.shaders().compute_supported) {
+		cout << "gl compute: GL 4.3 is not supported" << endl;
+		return;
+	}
+
+	// prepare data
+	PathStore store;
+	vector<ClRender3::Path> cl_paths;
+	prepare_cl3(data, store, cl_paths);
+
+	vector<GlComputeRender::Path> paths;
+	paths.reserve(cl_paths.size());
+	for(vector<ClRender3::Path>::const_iterator i = cl_paths.begin(); i != cl_paths.end(); ++i) {
+		GlComputeRender::Path path;
+		path.bounds = recti(i->bounds.minx, i->bounds.miny, i->bounds.maxx, i->bounds.maxy);
+		path.begin = i->begin;
+		path.end = i->end;
+		path.color = i->color;
+		path.invert = i->invert;
+		path.evenodd = i->evenodd;
+		paths.push_back(path);
+	}
+
+	// draw
+
+	GlComputeRender glr(e.gl(), e.shaders());
+	glr.send_points(store.get_points_data(), store.get_points_count());
+
+	// warm-up
+	for(vector<GlComputeRender::Path>::const_iterator i = paths.begin(); i != paths.end(); ++i)
+		glr.draw(*i);
+	glr.wait();
+	glClear(GL_COLOR_BUFFER_BIT);
+	glFinish();
+
+	{
+		Measure t("render", false, false, true);
+		for(vector<GlComputeRender::Path>::const_iterator i = paths.begin(); i != paths.end(); ++i)
+			glr.draw(*i);
+		glr.flush();
+	}
+}
+
+void Test::test_gl_readback(Environment &e, Data &data) {
+	const int frames = 100;
+
+	vector<GlRender::Path> paths;
+	prepare_paths(data, paths);
+
+	GlRender glr(e.shaders());
+	glr.send_paths(&paths.front(), (int)paths.size());
+
+	// wait for every frame
+	{
+		Measure t("sync readback");
+		GlReadback readback(1);
+		for(int i = 0; i < frames; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			glr.draw();
+			readback.read(std::string());
+			readback.flush();
+		}
+	}
+
+	// pixels of frame are read while the next frames are rendering
+	{
+		Measure t("async readback");
+		GlReadback readback;
+		for(int i = 0; i < frames; ++i) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			glr.draw();
+			readback.read(std::string());
+			readback.poll();
+		}
+		readback.flush();
 	}
 }
 
@@ -277,10 +452,205 @@ void Test::test_sw(Environment &e, Data &data, Surface &surface) {
 	}
 }
 
-void Test::test_cl(Environment &e, Data &data, Surface &surface) {
+void Test::build_index(const Data &data, Bvh &index) {
+	// inverted contours cover everything
+	const Real inf = numeric_limits<Real>::max();
+	vector<Rect> rects(data.size());
+	for(int i = 0; i < (int)data.size(); ++i)
+		rects[i] = data[i].invert
+		         ? Rect(-inf, -inf, inf, inf)
+		         : data[i].contour.get_bounds();
+	index.build(rects);
+}
+
+int Test::hit_test(const Data &data, const Bvh &index, const Vector &point) {
+	// candidates by bounds, then coverage of pixel under point, topmost contour first
+	vector<int> items;
+	index.query(point, items);
+
+	int x = (int)floor(point.x);
+	int y = (int)floor(point.y);
+	Polyspan polyspan;
+	Surface pixel(1, 1);
+	for(vector<int>::const_reverse_iterator i = items.rbegin(); i != items.rend(); ++i) {
+		const ContourInfo &info = data[*i];
+		polyspan.init(x, y, x + 1, y + 1);
+		info.contour.to_polyspan(polyspan);
+		polyspan.sort_marks();
+		polyspan.translate(-x, -y);
+		pixel.clear();
+		SwRender::polyspan(pixel, polyspan, Color(1.f, 1.f, 1.f, 1.f), info.evenodd, info.invert);
+		if (pixel.data->a >= 0.5f)
+			return *i;
+	}
+	return -1;
+}
+
+void Test::test_sw_culled(Environment&, Data &data, Surface &surface) {
+	const int warm_up_count = 100;
+	const int measure_count = 100;
+	Surface surface_tmp(surface.width, surface.height);
+	Rect viewport(0.0, 0.0, (Real)surface.width, (Real)surface.height);
+
+	Bvh index;
+	{
+		Measure t("build index");
+		build_index(data, index);
+	}
+
+	vector<int> visible;
+	index.query(viewport, visible);
+	cout << visible.size() << " of " << data.size() << " contours visible, "
+		 << index.get_nodes_count() << " nodes in index" << endl;
+
+	// warm-up and measure, query is a part of every frame
+	for(int ii = 0; ii < warm_up_count + measure_count + 1; ++ii) {
+		bool draw = ii == warm_up_count + measure_count;
+		Surface &target = draw ? surface : surface_tmp;
+		Measure t("render", false, ii >= warm_up_count && !draw);
+		index.query(viewport, visible);
+		vector<Polyspan> polyspans(visible.size());
+		for(int i = 0; i < (int)visible.size(); ++i) {
+			polyspans[i].init(0, 0, surface.width, surface.height);
+			data[visible[i]].contour.to_polyspan(polyspans[i]);
+			polyspans[i].sort_marks();
+		}
+		for(int i = 0; i < (int)visible.size(); ++i) {
+			const ContourInfo &info = data[visible[i]];
+			SwRender::polyspan(target, polyspans[i], info.color, info.evenodd, info.invert);
+		}
+	}
+
+	{
+		Measure t("hit test");
+		Vector point(0.5*surface.width, 0.5*surface.height);
+		cout << "contour " << hit_test(data, index, point)
+			 << " at " << point.x << ", " << point.y << endl;
+	}
+}
+
+void Test::test_sw_occlusion(Environment&, Data &data, Surface &surface) {
+	const int warm_up_count = 100;
+	const int measure_count = 100;
+	Surface surface_tmp(surface.width, surface.height);
+
+	Occlusion occlusion;
+	vector<bool> visible(data.size());
+	int visible_count = 0;
+	for(int ii = 0; ii < warm_up_count + measure_count + 1; ++ii) {
+		bool draw = ii == warm_up_count + measure_count;
+		Surface &target = draw ? surface : surface_tmp;
+		Measure t("render", false, ii >= warm_up_count && !draw);
+
+		vector<Polyspan> polyspans(data.size());
+		for(int i = 0; i < (int)data.size(); ++i) {
+			polyspans[i].init(0, 0, surface.width, surface.height);
+			data[i].contour.to_polyspan(polyspans[i]);
+			polyspans[i].sort_marks();
+		}
+
+		// back to front
+		occlusion.init(surface.width, surface.height);
+		visible_count = 0;
+		for(int i = (int)data.size() - 1; i >= 0; --i)
+			if ((visible[i] = occlusion.add(polyspans[i], data[i].evenodd, data[i].invert, i)))
+				++visible_count;
+
+		// front to back
+		for(int i = 0; i < (int)data.size(); ++i)
+			if (visible[i])
+				occlusion.draw(target, polyspans[i], data[i].color, data[i].evenodd, data[i].invert, i);
+	}
+	cout << visible_count << " of " << data.size() << " contours visible" << endl;
+}
+
+void Test::test_sw_store(Environment &e, Data &data, Surface &surface) {
+	const int warm_up_count = 1000;
+	const int measure_count = 1000;
+	Surface surface_tmp(surface.width, surface.height);
+
 	// prepare data
+	PathStore store;
+	prepare_store(data, store);
+	const vector<PathStore::Path> &paths = store.get_paths();
+
+	size_t contours_size = 0;
+	for(Data::const_iterator i = data.begin(); i != data.end(); ++i)
+		contours_size += sizeof(Contour) + i->contour.get_lod().get_chunks().capacity()*sizeof(Contour::Chunk);
+	cout << "path store: " << store.get_memory_size() << " bytes, contours: " << contours_size << " bytes" << endl;
+
+	// warm-up
+	for(int ii = 0; ii < warm_up_count; ++ii) {
+		vector<Polyspan> polyspans(paths.size());
+		for(int i = 0; i < (int)paths.size(); ++i) {
+			polyspans[i].init(0, 0, surface.width, surface.height);
+			store.to_polyspan(paths[i], polyspans[i]);
+			polyspans[i].sort_marks();
+		}
+		for(int i = 0; i < (int)paths.size(); ++i)
+			SwRender::polyspan(surface_tmp, polyspans[i], paths[i].color, paths[i].evenodd, paths[i].invert);
+	}
+
+	// measure
+	for(int ii = 0; ii < measure_count; ++ii) {
+		Measure t("render", false, true);
+		vector<Polyspan> polyspans(paths.size());
+		for(int i = 0; i < (int)paths.size(); ++i) {
+			polyspans[i].init(0, 0, surface.width, surface.height);
+			store.to_polyspan(paths[i], polyspans[i]);
+			polyspans[i].sort_marks();
+		}
+		for(int i = 0; i < (int)paths.size(); ++i)
+			SwRender::polyspan(surface_tmp, polyspans[i], paths[i].color, paths[i].evenodd, paths[i].invert);
+	}
+
+	{ // draw
+		vector<Polyspan> polyspans(paths.size());
+		for(int i = 0; i < (int)paths.size(); ++i) {
+			polyspans[i].init(0, 0, surface.width, surface.height);
+			store.to_polyspan(paths[i], polyspans[i]);
+			polyspans[i].sort_marks();
+		}
+		for(int i = 0; i < (int)paths.size(); ++i)
+			SwRender::polyspan(surface, polyspans[i], paths[i].color, paths[i].evenodd, paths[i].invert);
+	}
+}
 
-	vector<char> paths(sizeof(int));
+void Test::prepare_paths(const Data &data, vector<ContourPath> &paths) {
+	paths.clear();
+	paths.reserve(data.size());
+	for(Data::const_iterator i = data.begin(); i != data.end(); ++i) {
+		ContourPath path;
+		path.contour = &i->contour;
+		path.color = i->color;
+		path.invert = i->invert;
+		path.evenodd = i->evenodd;
+		paths.push_back(path);
+	}
+}
+
+void Test::prepare_paths(const Data &data, vector<Renderer::Path> &paths) {
+	vector<ContourPath> contour_paths;
+	prepare_paths(data, contour_paths);
+	paths.resize(contour_paths.size());
+	for(int i = 0; i < (int)paths.size(); ++i) {
+		static_cast<ContourPath&>(paths[i]) = contour_paths[i];
+		paths[i].transform = Affine();
+	}
+}
+
+void Test::prepare_store(const Data &data, PathStore &store) {
+	int chunks_count = 0;
+	for(Data::const_iterator i = data.begin(); i != data.end(); ++i)
+		chunks_count += (int)i->contour.get_lod().get_chunks().size();
+	store.reserve((int)data.size(), chunks_count);
+	for(Data::const_iterator i = data.begin(); i != data.end(); ++i)
+		store.add(i->contour.get_lod(), i->color, i->invert, i->evenodd);
+}
+
+void Test::prepare_cl(const Data &data, vector<char> &paths) {
+	paths.clear();
+	paths.resize(sizeof(int));
 	int count = 0;
 	for(Data::const_iterator i = data.begin(); i != data.end(); ++i)
 		if (int points_count = i->contour.get_chunks().size()) {
@@ -303,10 +673,114 @@ void Test::test_cl(Environment &e, Data &data, Surface &surface) {
 			*point = vec2f(i->contour.get_chunks().front().p1);
 		}
 	*(int*)&paths.front() = count;
+}
+
+void Test::test_sw_pan(Environment &e, Data &data, Surface &surface) {
+	// panning: every frame draws the same contours with another translation,
+	// so software renderer should take them from mask cache after first frame
+	const int frames_count = 100;
+	const Vector step(1.25, 0.5);
+
+	Renderer *renderer = Renderer::create("sw", e);
+	if (!renderer) {
+		cout << "unknown renderer: sw" << endl;
+		return;
+	}
+
+	vector<Renderer::Path> paths;
+	prepare_paths(data, paths);
+
+	Surface surface_tmp(surface.width, surface.height);
+	for(int ii = 0; ii < frames_count; ++ii) {
+		// last frame is drawn without offset
+		Affine transform = Affine::translation(step*(Real)(ii + 1 - frames_count));
+		for(vector<Renderer::Path>::iterator i = paths.begin(); i != paths.end(); ++i)
+			i->transform = transform;
+
+		bool last = ii + 1 == frames_count;
+		Surface &target = last ? surface : surface_tmp;
+		target.clear();
+
+		Measure t(ii ? "frame" : "first frame", false, ii && !last);
+		renderer->send_paths(&paths.front(), (int)paths.size());
+		renderer->send_surface(&target);
+		renderer->draw();
+		renderer->receive_surface();
+	}
+	renderer->send_surface(NULL);
+	delete renderer;
+}
+
+void Test::test_sw_scene(Environment&, Data &data, Surface &surface) {
+	// editor: one contour is moved every frame, only its old and new bounds are repainted
+	const int frames_count = 100;
+
+	Scene scene(surface.width, surface.height);
+	vector<int> ids;
+	ids.reserve(data.size());
+	for(Data::const_iterator i = data.begin(); i != data.end(); ++i)
+		ids.push_back(scene.add(i->contour, i->color, i->invert, i->evenodd));
+
+	{
+		Measure t("full redraw");
+		scene.draw(surface);
+	}
+
+	int count = 0;
+	for(int ii = 0; ii < frames_count; ++ii) {
+		int id = ids[(ii*7919) % ids.size()];
+		Vector offset(ii % 2 ? 4.0 : -4.0, 0.0);
+
+		Measure t("edit", false, true);
+		scene.transform(id, Affine::translation(offset));
+		count += scene.draw(surface);
+	}
+	cout << count/frames_count << " contours repainted per frame of " << ids.size() << endl;
+}
+
+void Test::test_sw_edit(Environment&, Surface &surface) {
+	// one point of large contour is dragged every frame, only changed edges are rasterized again
+	const int frames_count = 100;
+
+	Contour contour;
+	ContourBuilder::build(contour);
+	contour.transform(
+		Rect(-1.0, -1.0, 1.0, 1.0),
+		Rect(0.0, 0.0, (Real)surface.width, (Real)surface.height) );
+
+	ContourRaster raster;
+	raster.init(0, 0, surface.width, surface.height);
+	Polyspan polyspan;
+	{
+		Measure t("full rasterization");
+		raster.update(contour);
+		raster.to_polyspan(polyspan);
+	}
+
+	int count = 0;
+	for(int ii = 0; ii < frames_count; ++ii) {
+		int index = (ii*7919) % contour.get_chunks().size();
+		Contour::Chunk chunk = contour.get_chunks()[index];
+		chunk.p1 = chunk.p1 + Vector(ii % 2 ? 2.0 : -2.0, 0.0);
+
+		Measure t("edit", false, true);
+		contour.set_chunk(index, chunk);
+		count += raster.update(contour);
+		raster.to_polyspan(polyspan);
+	}
+	cout << count/frames_count << " edges rasterized per edit of " << raster.get_edges_count() << endl;
+
+	SwRender::polyspan(surface, polyspan, Color(0.f, 0.f, 1.f, 1.f), false, false);
+}
+
+void Test::test_cl(Environment &e, Data &data, Surface &surface) {
+	// prepare data
+	vector<char> paths;
+	prepare_cl(data, paths);
 
 	// draw
 
-	ClRender clr(e.cl);
+	ClRender clr(e.cl());
 	clr.send_surface(&surface);
 
 	// warm-up
@@ -326,11 +800,9 @@ void Test::test_cl(Environment &e, Data &data, Surface &surface) {
 	clr.receive_surface();
 }
 
-void Test::test_cl2(Environment &e, Data &data, Surface &surface) {
-	// prepare data
-
-	vector<ClRender2::Path> paths;
-	vector<ClRender2::Point> points;
+void Test::prepare_cl2(const Data &data, vector<ClRender2::Path> &paths, vector<ClRender2::Point> &points) {
+	paths.clear();
+	points.clear();
 	paths.reserve(data.size());
 	for(Data::const_iterator i = data.begin(); i != data.end(); ++i)
 		if (int points_count = i->contour.get_chunks().size()) {
@@ -354,10 +826,17 @@ void Test::test_cl2(Environment &e, Data &data, Surface &surface) {
 			}
 			points.push_back(points[first_point_index]);
 		}
+}
+
+void Test::test_cl2(Environment &e, Data &data, Surface &surface) {
+	// prepare data
+	vector<ClRender2::Path> paths;
+	vector<ClRender2::Point> points;
+	prepare_cl2(data, paths, points);
 
 	// draw
 
-	ClRender2 clr(e.cl);
+	ClRender2 clr(e.cl());
 
 	// warm-up
 	{
@@ -379,48 +858,37 @@ void Test::test_cl2(Environment &e, Data &data, Surface &surface) {
 	clr.receive_surface();
 }
 
+void Test::prepare_cl3(const Data &data, PathStore &store, vector<ClRender3::Path> &paths) {
+	store.init((1024 - 1)/sizeof(vec2f) + 1);
+	prepare_store(data, store);
+
+	paths.clear();
+	paths.reserve(store.get_paths().size());
+	for(vector<PathStore::Path>::const_iterator i = store.get_paths().begin(); i != store.get_paths().end(); ++i) {
+		ClRender3::Path path = {};
+		path.bounds = i->bounds;
+		path.begin = i->begin;
+		path.end = i->end;
+		path.color = i->color;
+		path.invert = i->invert;
+		path.evenodd = i->evenodd;
+		paths.push_back(path);
+	}
+}
+
 void Test::test_cl3(Environment &e, Data &data, Surface &surface) {
 	// prepare data
-	int align = (1024 - 1)/sizeof(vec2f) + 1;
+	PathStore store;
 	vector<ClRender3::Path> paths;
-	vector<vec2f> points;
-	paths.reserve(data.size());
-	for(Data::const_iterator i = data.begin(); i != data.end(); ++i) {
-		if (!i->contour.get_chunks().empty()) {
-			ClRender3::Path path = {};
-			path.color = i->color;
-			path.invert = i->invert;
-			path.evenodd = i->evenodd;
-
-			path.bounds.minx = path.bounds.maxx = (int)floor(i->contour.get_chunks().front().p1.x);
-			path.bounds.miny = path.bounds.maxy = (int)floor(i->contour.get_chunks().front().p1.y);
-			path.begin = (int)points.size();
-			points.reserve(points.size() + i->contour.get_chunks().size() + 1);
-			for(Contour::ChunkList::const_iterator j = i->contour.get_chunks().begin(); j != i->contour.get_chunks().end(); ++j) {
-				int x = (int)floor(j->p1.x);
-				int y = (int)floor(j->p1.y);
-				if (path.bounds.minx > x) path.bounds.minx = x;
-				if (path.bounds.maxx < x) path.bounds.maxx = x;
-				if (path.bounds.miny > y) path.bounds.miny = y;
-				if (path.bounds.maxy < y) path.bounds.maxy = y;
-				points.push_back(vec2f(j->p1));
-			}
-			path.end = (int)points.size();
-			do { points.push_back( points[path.begin] ); } while(points.size() % align);
-			++path.bounds.maxx;
-			++path.bounds.maxy;
-
-			paths.push_back(path);
-		}
-	}
+	prepare_cl3(data, store, paths);
 
 	// draw
 
-	ClRender3 clr(e.cl);
+	ClRender3 clr(e.cl());
 
 	// warm-up
 	clr.send_surface(&surface);
-	clr.send_points(&points.front(), (int)points.size());
+	clr.send_points(store.get_points_data(), store.get_points_count());
 	for(int ii = 0; ii < 1000; ++ii)
 		for(vector<ClRender3::Path>::const_iterator i = paths.begin(); i != paths.end(); ++i)
 			clr.draw(*i);
@@ -440,7 +908,7 @@ void Test::test_cl3(Environment &e, Data &data, Surface &surface) {
 
 	// actual task
 	clr.send_surface(&surface);
-	clr.send_points(&points.front(), (int)points.size());
+	clr.send_points(store.get_points_data(), store.get_points_count());
 	{
 		for(vector<ClRender3::Path>::const_iterator i = paths.begin(); i != paths.end(); ++i)
 			clr.draw(*i);
@@ -449,48 +917,89 @@ void Test::test_cl3(Environment &e, Data &data, Surface &surface) {
 	clr.receive_surface();
 }
 
-void Test::test_cu(Environment &e, Data &data, Surface &surface) {
-#ifdef CUDA
+void Test::test_cl3_transform(Environment &e, Data &data, Surface &surface) {
+	const int frames = 1000;
+
 	// prepare data
-	vector<CudaRender::Path> paths;
-	vector<vec2f> points;
-	paths.reserve(data.size());
-	for(Data::const_iterator i = data.begin(); i != data.end(); ++i) {
-		if (!i->contour.get_chunks().empty()) {
-			CudaRender::Path path = {};
-			path.color = i->color;
-			path.invert = i->invert;
-			path.evenodd = i->evenodd;
+	PathStore store;
+	vector<ClRender3::Path> paths;
+	prepare_cl3(data, store, paths);
 
-			path.bounds.minx = path.bounds.maxx = (int)floor(i->contour.get_chunks().front().p1.x);
-			path.bounds.miny = path.bounds.maxy = (int)floor(i->contour.get_chunks().front().p1.y);
-			path.begin = (int)points.size();
-			points.reserve(points.size() + i->contour.get_chunks().size() + 1);
-			for(Contour::ChunkList::const_iterator j = i->contour.get_chunks().begin(); j != i->contour.get_chunks().end(); ++j) {
-				int x = (int)floor(j->p1.x);
-				int y = (int)floor(j->p1.y);
-				if (path.bounds.minx > x) path.bounds.minx = x;
-				if (path.bounds.maxx < x) path.bounds.maxx = x;
-				if (path.bounds.miny > y) path.bounds.miny = y;
-				if (path.bounds.maxy < y) path.bounds.maxy = y;
-				points.push_back(vec2f(j->p1));
-			}
-			path.end = (int)points.size();
-			points.push_back( points[path.begin] );
-			++path.bounds.maxx;
-			++path.bounds.maxy;
+	// zoom to the frame center and back, points sent only once
+	vec2f center((float)surface.width*0.5f, (float)surface.height*0.5f);
+	vector<affine2f> transforms(frames);
+	for(int i = 0; i < frames; ++i) {
+		float scale = 1.f + 0.5f*(float)sin(M_PI*i/frames);
+		transforms[i] = affine2f::translation(center)
+		              * affine2f::scaling(vec2f(scale, scale))
+		              * affine2f::translation(center*-1.f);
+	}
 
-			paths.push_back(path);
+	// draw
+
+	ClRender3 clr(e.cl());
+	Surface surface_tmp(surface.width, surface.height);
+
+	// warm-up
+	clr.send_surface(&surface_tmp);
+	clr.send_points(store.get_points_data(), store.get_points_count());
+	for(int ii = 0; ii < frames; ++ii) {
+		clr.set_transform(transforms[ii]);
+		for(vector<ClRender3::Path>::const_iterator i = paths.begin(); i != paths.end(); ++i)
+			clr.draw(*i);
+	}
+	clr.wait();
+
+	// measure
+	{
+		for(int ii = 0; ii < frames; ++ii) {
+			Measure t("render", false, true);
+			clr.set_transform(transforms[ii]);
+			for(vector<ClRender3::Path>::const_iterator i = paths.begin(); i != paths.end(); ++i)
+				clr.draw(*i);
+			clr.wait();
 		}
 	}
+	clr.send_surface(NULL);
+
+	// actual task, last frame has identity transform
+	clr.send_surface(&surface);
+	clr.set_transform(affine2f());
+	{
+		for(vector<ClRender3::Path>::const_iterator i = paths.begin(); i != paths.end(); ++i)
+			clr.draw(*i);
+		clr.wait();
+	}
+	clr.receive_surface();
+	clr.send_points(NULL, 0);
+}
+
+void Test::test_cu(Environment &e, Data &data, Surface &surface) {
+#ifdef CUDA
+	// prepare data
+	PathStore store;
+	prepare_store(data, store);
+
+	vector<CudaRender::Path> paths;
+	paths.reserve(store.get_paths().size());
+	for(vector<PathStore::Path>::const_iterator i = store.get_paths().begin(); i != store.get_paths().end(); ++i) {
+		CudaRender::Path path = {};
+		path.bounds = i->bounds;
+		path.begin = i->begin;
+		path.end = i->end;
+		path.color = i->color;
+		path.invert = i->invert;
+		path.evenodd = i->evenodd;
+		paths.push_back(path);
+	}
 
 	// draw
 
-	CudaRender cur(e.cu);
+	CudaRender cur(e.cu());
 
 	// warm-up
 	cur.send_surface(&surface);
-	cur.send_points(&points.front(), (int)points.size());
+	cur.send_points(store.get_points_data(), store.get_points_count());
 	for(int ii = 0; ii < 1000; ++ii)
 		for(vector<CudaRender::Path>::const_iterator i = paths.begin(); i != paths.end(); ++i)
 			cur.draw(*i);
@@ -510,7 +1019,7 @@ void Test::test_cu(Environment &e, Data &data, Surface &surface) {
 
 	// actual task
 	cur.send_surface(&surface);
-	cur.send_points(&points.front(), (int)points.size());
+	cur.send_points(store.get_points_data(), store.get_points_count());
 	{
 		for(vector<CudaRender::Path>::const_iterator i = paths.begin(); i != paths.end(); ++i)
 			cur.draw(*i);
@@ -519,3 +1028,294 @@ void Test::test_cu(Environment &e, Data &data, Surface &surface) {
 	cur.receive_surface();
 #endif
 }
+
+void Test::test_hybrid(Environment &e, Data &data, Surface &surface) {
+	// prepare data
+	vector<HybridRender::Path> paths;
+	prepare_paths(data, paths);
+
+	// draw
+
+	ThreadPool pool;
+	HybridRender hr(e.cl(), pool);
+	Surface surface_tmp(surface.width, surface.height);
+
+	// warm-up, also moves split row to the balanced position
+	hr.send_surface(&surface_tmp);
+	hr.send_paths(&paths.front(), (int)paths.size());
+	for(int ii = 0; ii < 1000; ++ii)
+		hr.draw();
+
+	// measure
+	{
+		for(int ii = 0; ii < 1000; ++ii) {
+			Measure t("render", false, true);
+			hr.draw();
+		}
+	}
+	cout << "hybrid: " << pool.count() << " threads, "
+		 << hr.get_split() << " of " << surface.height << " rows by OpenCL" << endl;
+
+	// actual task
+	hr.send_surface(&surface);
+	hr.draw();
+}
+
+void Test::test_sw_band(Environment&, Data &data, Surface &surface) {
+	// prepare data
+	vector<BandRender::Path> paths;
+	prepare_paths(data, paths);
+
+	// draw
+
+	BandRender br;
+	Surface surface_tmp(surface.width, surface.height);
+
+	// warm-up
+	br.send_surface(&surface_tmp);
+	br.send_paths(&paths.front(), (int)paths.size());
+	for(int ii = 0; ii < 100; ++ii)
+		br.draw();
+
+	// measure
+	for(int ii = 0; ii < 100; ++ii) {
+		Measure t("render", false, true);
+		br.draw();
+	}
+	cout << "band: " << br.get_band_height() << " rows, "
+		 << br.get_reserved_marks() << " marks reserved of "
+		 << br.get_max_marks() << " allowed" << endl;
+
+	// inverted contour with separate subpaths has empty rows between marks,
+	// bands move these rows, so result is compared with single polyspan
+	{
+		Contour contour;
+		for(int i = 1; i <= 3; ++i)
+			ContourBuilder::build_car(contour, Vector(surface.width*i/4, surface.height*i/4), surface.height/64);
+		BandRender::Path path;
+		path.contour = &contour;
+		path.color = Color(1, 1, 1, 1);
+		path.invert = true;
+		path.evenodd = false;
+
+		surface_tmp.clear();
+		br.send_surface(&surface_tmp);
+		br.send_paths(&path, 1);
+		br.draw();
+
+		Surface surface_sw(surface.width, surface.height);
+		Polyspan polyspan;
+		polyspan.init(0, 0, surface.width, surface.height);
+		contour.to_polyspan(polyspan);
+		polyspan.sort_marks();
+		SwRender::polyspan(surface_sw, polyspan, path.color, path.evenodd, path.invert);
+
+		Color::type diff = 0;
+		for(int i = 0; i < surface.count(); ++i)
+			diff = max(diff, fabs(surface_tmp.data[i].a - surface_sw.data[i].a));
+		cout << "band: inverted contour differs from polyspan by " << diff << endl;
+	}
+
+	// actual task
+	br.send_surface(&surface);
+	br.send_paths(&paths.front(), (int)paths.size());
+	br.draw();
+}
+
+void Test::test_sw_batch(Environment&, Data &data, Surface &surface) {
+	// prepare data
+	vector<BatchRender::Path> paths;
+	prepare_paths(data, paths);
+
+	// draw
+
+	BatchRender br;
+	Surface surface_tmp(surface.width, surface.height);
+
+	// warm-up
+	br.send_surface(&surface_tmp);
+	br.send_paths(&paths.front(), (int)paths.size());
+	for(int ii = 0; ii < 100; ++ii)
+		br.draw();
+
+	// measure
+	for(int ii = 0; ii < 100; ++ii) {
+		Measure t("render", false, true);
+		br.draw();
+	}
+	cout << "batch: " << paths.size() << " paths in " << br.get_batches() << " batches" << endl;
+
+	// actual task
+	br.send_surface(&surface);
+	br.draw();
+}
+
+void Test::test_sw_split(Environment&, Data &data, Surface &surface) {
+	const int warm_up_count = 100;
+	const int measure_count = 100;
+	Surface surface_tmp(surface.width, surface.height);
+
+	ThreadPool pool;
+	ParallelRaster raster(pool);
+	Polyspan polyspan;
+
+	// warm-up
+	for(int ii = 0; ii < warm_up_count; ++ii) {
+		for(int i = 0; i < (int)data.size(); ++i) {
+			polyspan.init(0, 0, surface.width, surface.height);
+			raster.to_polyspan(data[i].contour, polyspan);
+			SwRender::polyspan(surface_tmp, polyspan, data[i].color, data[i].evenodd, data[i].invert);
+		}
+	}
+
+	// measure
+	for(int ii = 0; ii < measure_count; ++ii) {
+		Measure t("render", false, true);
+		for(int i = 0; i < (int)data.size(); ++i) {
+			polyspan.init(0, 0, surface.width, surface.height);
+			raster.to_polyspan(data[i].contour, polyspan);
+			SwRender::polyspan(surface_tmp, polyspan, data[i].color, data[i].evenodd, data[i].invert);
+		}
+	}
+
+	// draw
+	for(int i = 0; i < (int)data.size(); ++i) {
+		polyspan.init(0, 0, surface.width, surface.height);
+		raster.to_polyspan(data[i].contour, polyspan);
+		SwRender::polyspan(surface, polyspan, data[i].color, data[i].evenodd, data[i].invert);
+	}
+}
+
+void Test::test_sw_parallel(Environment&, Data &data, Surface &surface) {
+	// prepare data
+	vector<ParallelRender::Path> paths;
+	prepare_paths(data, paths);
+
+	// draw
+
+	ThreadPool pool;
+	ParallelRender pr(pool);
+	Surface surface_tmp(surface.width, surface.height);
+
+	// warm-up
+	pr.send_surface(&surface_tmp);
+	pr.send_paths(&paths.front(), (int)paths.size());
+	for(int ii = 0; ii < 100; ++ii)
+		pr.draw();
+
+	// measure
+	for(int ii = 0; ii < 100; ++ii) {
+		Measure t("render", false, true);
+		pr.draw();
+	}
+	cout << "parallel: " << pool.count() << " threads, "
+		 << pr.get_window_size() << " polyspans in flight" << endl;
+
+	// actual task
+	pr.send_surface(&surface);
+	pr.draw();
+}
+
+static void draw_by_renderer(Renderer &renderer, const vector<Renderer::Path> &paths, Surface &surface) {
+	{
+		Measure t("send paths");
+		renderer.send_paths(paths.empty() ? NULL : &paths.front(), (int)paths.size());
+	}
+
+	// warm-up
+	Surface surface_tmp(surface.width, surface.height);
+	renderer.send_surface(&surface_tmp);
+	renderer.draw();
+	renderer.receive_surface();
+
+	// actual task
+	renderer.send_surface(&surface);
+	{
+		Measure t("render");
+		renderer.draw();
+		renderer.receive_surface();
+	}
+	renderer.send_surface(NULL);
+}
+
+void Test::test_renderer(Environment &e, const std::string &name, Data &data, Surface &surface) {
+	Renderer *renderer = Renderer::create(name, e);
+	if (!renderer) {
+		cout << "unknown renderer: " << name << endl;
+		return;
+	}
+
+	vector<Renderer::Path> paths;
+	prepare_paths(data, paths);
+
+	draw_by_renderer(*renderer, paths, surface);
+	delete renderer;
+}
+
+void Test::test_instances(Environment &e, const std::string &name, Surface &surface) {
+	Renderer *renderer = Renderer::create(name, e);
+	if (!renderer) {
+		cout << "unknown renderer: " << name << endl;
+		return;
+	}
+
+	// one contour drawn many times
+	Contour car;
+	ContourBuilder::build_car(car, Vector::zero(), 1.0);
+	vector<Affine> transforms;
+	ContourBuilder::build_instances(transforms);
+
+	Affine to_frame = Affine::rect_to_rect(
+		Rect(-1.0, -1.0, 1.0, 1.0),
+		Rect(0.0, 0.0, (Real)surface.width, (Real)surface.height) );
+	vector<Renderer::Path> paths(transforms.size());
+	for(int i = 0; i < (int)paths.size(); ++i) {
+		paths[i].contour = &car;
+		paths[i].transform = to_frame*transforms[i];
+		paths[i].color = Color((float)(i%5)/4.f, (float)(i%7)/6.f, (float)(i%3)/2.f, 1.f);
+		paths[i].invert = false;
+		paths[i].evenodd = false;
+	}
+	cout << paths.size() << " instances of contour with "
+		 << car.get_chunks().size() << " chunks" << endl;
+
+	draw_by_renderer(*renderer, paths, surface);
+	delete renderer;
+}
+
+void Test::tune_cl(Environment &e, Data &data, Surface &surface) {
+	Measure t("tune_cl");
+
+	{ // ClRender
+		vector<char> paths;
+		prepare_cl(data, paths);
+		ClRender clr(e.cl());
+		clr.send_surface(&surface);
+		clr.send_paths(&paths.front(), paths.size());
+		{ Measure t("ClRender"); clr.tune(); }
+	}
+
+	{ // ClRender2
+		vector<ClRender2::Path> paths;
+		vector<ClRender2::Point> points;
+		prepare_cl2(data, paths, points);
+		ClRender2 clr(e.cl());
+		clr.send_surface(&surface);
+		clr.send_paths(&paths.front(), (int)paths.size(), &points.front(), (int)points.size());
+		{ Measure t("ClRender2"); clr.tune(); }
+	}
+
+	{ // ClRender3
+		PathStore store;
+		vector<ClRender3::Path> paths;
+		prepare_cl3(data, store, paths);
+		ClRender3 clr(e.cl());
+		clr.send_surface(&surface);
+		clr.send_points(store.get_points_data(), store.get_points_count());
+		{ Measure t("ClRender3"); clr.tune(&paths.front(), (int)paths.size()); }
+	}
+
+	surface.clear();
+	e.cl().profile.save();
+	cout << "CL profile saved to " << e.cl().profile.get_filename() << endl;
+}
@@ -23,6 +23,10 @@
 
 #include "contour.h"
 #include "environment.h"
+#include "clrender.h"
+#include "pathstore.h"
+#include "renderer.h"
+#include "bvh.h"
 
 class Test {
 public:
@@ -46,17 +50,47 @@ public:
 		bool invert,
 		const Color &color );
 
+	static void prepare_cl(const Data &data, std::vector<char> &paths);
+	static void prepare_cl2(const Data &data, std::vector<ClRender2::Path> &paths, std::vector<ClRender2::Point> &points);
+	static void prepare_cl3(const Data &data, PathStore &store, std::vector<ClRender3::Path> &paths);
+	static void prepare_paths(const Data &data, std::vector<ContourPath> &paths);
+	static void prepare_paths(const Data &data, std::vector<Renderer::Path> &paths);
+	static void prepare_store(const Data &data, PathStore &store);
+
 	static void load(Data &data, const std::string &filename);
 	static void transform(Data &data, const Rect &from, const Rect &to);
 	static void downgrade(Data &from, Data &to);
+	static void build_lod(Data &data);
 	static void split(Data &from, Data &to);
+	static void build_index(const Data &data, Bvh &index);
+	// index of topmost contour which covers pixel under point, or -1
+	static int hit_test(const Data &data, const Bvh &index, const Vector &point);
 
 	static void test_gl_stencil(Environment &e, Data &data);
+	static void test_gl_batch(Environment &e, Data &data, bool triangulate = false);
+	static void test_gl_compute(Environment &e, Data &data);
+	static void test_gl_readback(Environment &e, Data &data);
 	static void test_sw(Environment &e, Data &data, Surface &surface);
+	static void test_sw_store(Environment &e, Data &data, Surface &surface);
+	static void test_sw_culled(Environment &e, Data &data, Surface &surface);
+	static void test_sw_occlusion(Environment &e, Data &data, Surface &surface);
+	static void test_sw_pan(Environment &e, Data &data, Surface &surface);
+	static void test_sw_scene(Environment &e, Data &data, Surface &surface);
+	static void test_sw_edit(Environment &e, Surface &surface);
 	static void test_cl(Environment &e, Data &data, Surface &surface);
 	static void test_cl2(Environment &e, Data &data, Surface &surface);
 	static void test_cl3(Environment &e, Data &data, Surface &surface);
+	static void test_cl3_transform(Environment &e, Data &data, Surface &surface);
 	static void test_cu(Environment &e, Data &data, Surface &surface);
+	static void test_hybrid(Environment &e, Data &data, Surface &surface);
+	static void test_sw_parallel(Environment &e, Data &data, Surface &surface);
+	static void test_sw_split(Environment &e, Data &data, Surface &surface);
+	static void test_sw_band(Environment &e, Data &data, Surface &surface);
+	static void test_sw_batch(Environment &e, Data &data, Surface &surface);
+	static void test_renderer(Environment &e, const std::string &name, Data &data, Surface &surface);
+	static void test_instances(Environment &e, const std::string &name, Surface &surface);
+
+	static void tune_cl(Environment &e, Data &data, Surface &surface);
 };
 
 #endif
@@ -0,0 +1,92 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cassert>
+
+#include "threadpool.h"
+
+
+using namespace std;
+
+
+ThreadPool::ThreadPool(int count):
+	task(),
+	generation(),
+	running(),
+	stop()
+{
+	if (count <= 0)
+		count = (int)thread::hardware_concurrency();
+	if (count <= 0)
+		count = 1;
+
+	// current thread also works, so create one thread less
+	threads.reserve(count - 1);
+	for(int i = 1; i < count; ++i)
+		threads.push_back(thread(&ThreadPool::worker, this, i));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		unique_lock<std::mutex> lock(mutex);
+		stop = true;
+	}
+	condition.notify_all();
+	for(vector<thread>::iterator i = threads.begin(); i != threads.end(); ++i)
+		i->join();
+}
+
+void ThreadPool::worker(int index) {
+	long long done_generation = 0;
+	while(true) {
+		Task *current = NULL;
+		{
+			unique_lock<std::mutex> lock(mutex);
+			while(!stop && generation == done_generation)
+				condition.wait(lock);
+			if (stop) return;
+			done_generation = generation;
+			current = task;
+		}
+
+		current->run(index, count());
+
+		{
+			unique_lock<std::mutex> lock(mutex);
+			if (--running == 0)
+				done_condition.notify_all();
+		}
+	}
+}
+
+void ThreadPool::run(Task &task) {
+	{
+		unique_lock<std::mutex> lock(mutex);
+		assert(!running);
+		this->task = &task;
+		running = (int)threads.size();
+		++generation;
+	}
+	condition.notify_all();
+
+	task.run(0, count());
+
+	unique_lock<std::mutex> lock(mutex);
+	while(running)
+		done_condition.wait(lock);
+	this->task = NULL;
+}
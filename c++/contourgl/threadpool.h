@@ -0,0 +1,63 @@
+/*
+    ......... 2018 Ivan Mahonin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef _THREADPOOL_H_
+#define _THREADPOOL_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+class ThreadPool {
+public:
+	class Task {
+	public:
+		virtual ~Task() { }
+		// called once in every thread of pool, thread 0 is the caller of ThreadPool::run
+		virtual void run(int thread_index, int thread_count) = 0;
+	};
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::condition_variable done_condition;
+
+	Task *task;
+	long long generation;
+	int running;
+	bool stop;
+
+	ThreadPool(const ThreadPool&): task(), generation(), running(), stop() { }
+	ThreadPool& operator= (const ThreadPool&) { return *this; }
+
+	void worker(int index);
+
+public:
+	// zero means count of hardware threads
+	explicit ThreadPool(int count = 0);
+	~ThreadPool();
+
+	int count() const { return (int)threads.size() + 1; }
+
+	// run task in all threads (including current) and wait for finish
+	void run(Task &task);
+};
+
+#endif
@@ -15,7 +15,10 @@
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include <iostream>
+#include <cmath>
+
+#include <set>
+#include <algorithm>
 
 #include "triangulator.h"
 
@@ -23,102 +26,483 @@
 using namespace std;
 
 
-bool Triangulator::intersect_lines(Vector a0, Vector a1, Vector b0, Vector b1) {
-	static const Real precision = 1e-6;
+namespace {
+
+// Sweep goes from top (greatest y) to bottom, vertices with same y goes from left to right.
+// Edge with index i connects vertex i with vertex next(i).
+
+struct Vertex {
+	Vector p;
+	int prev;
+	int next;
+	int polygon;
+	Vertex(): prev(), next(), polygon() { }
+};
+
+typedef vector<Vertex> VertexList;
+
+inline Real cross(const Vector &a, const Vector &b)
+	{ return a.x*b.y - a.y*b.x; }
+
+inline bool above(const Vector &a, const Vector &b)
+	{ return a.y > b.y || (a.y == b.y && a.x < b.x); }
+
+// positive when point is to the right of edge directed downward
+inline Real side(const Vector &top, const Vector &bottom, const Vector &p)
+	{ return cross(bottom - top, p - top); }
+
+struct AboveLess {
+	const VertexList &vertices;
+	explicit AboveLess(const VertexList &vertices): vertices(vertices) { }
+	bool operator() (int a, int b) const
+		{ return above(vertices[a].p, vertices[b].p); }
+};
+
+// orders edges crossing the sweep line from left to right,
+// edges never intersects, so order is not changed while edge is in the set,
+// edge with index -1 is a query point (see EdgeSet::left_of)
+class EdgeSet {
+public:
+	struct Less {
+		const EdgeSet &owner;
+		explicit Less(const EdgeSet &owner): owner(owner) { }
+		bool operator() (int a, int b) const { return owner.less(a, b); }
+	};
+
+	typedef set<int, Less> Set;
+	typedef Set::iterator Iterator;
 
-	Vector da(a1 - a0);
-	Vector pa(-da.y, da.x);
+	const VertexList &vertices;
+	Vector query_point;
+	Set edges;
+	vector<Iterator> iterators;
 
-	Real d0, d1;
+	explicit EdgeSet(const VertexList &vertices):
+		vertices(vertices), edges(Less(*this)), iterators(vertices.size(), edges.end()) { }
+
+	const Vector& top(int e) const {
+		if (e < 0) return query_point;
+		const Vector &a = vertices[e].p, &b = vertices[vertices[e].next].p;
+		return above(a, b) ? a : b;
+	}
+
+	const Vector& bottom(int e) const {
+		if (e < 0) return query_point;
+		const Vector &a = vertices[e].p, &b = vertices[vertices[e].next].p;
+		return above(a, b) ? b : a;
+	}
+
+	bool less(int a, int b) const {
+		if (a == b) return false;
+		const Vector &at = top(a), &bt = top(b);
+		Real s;
+		if (at.x == bt.x && at.y == bt.y) {
+			// edges from one vertex, compare directions
+			s = -side(bt, bottom(b), bottom(a));
+		} else
+		if (above(at, bt)) {
+			s = side(at, bottom(a), bt);
+		} else {
+			s = -side(bt, bottom(b), at);
+		}
+		return s == 0.0 ? a < b : s > 0.0;
+	}
+
+	Iterator insert(int e)
+		{ return iterators[e] = edges.insert(e).first; }
+	void erase(int e) {
+		if (iterators[e] != edges.end())
+			{ edges.erase(iterators[e]); iterators[e] = edges.end(); }
+	}
 
-	d0 = pa.dot(b0 - a0);
-	if (fabs(d0) < precision) return false;
-	d1 = pa.dot(b1 - a0);
-	if (fabs(d1) < precision) return false;
-	if ((d0 > 0.0) == (d1 > 0.0)) return false;
+	// edge directly to the left of point, or -1
+	int left_of(const Vector &p) {
+		query_point = p;
+		Iterator i = edges.lower_bound(-1);
+		return i == edges.begin() ? -1 : *--i;
+	}
 
-	Vector db(b1 - b0);
-	Vector pb(-db.y, db.x);
+	int prev(int e) const {
+		Iterator i = iterators[e];
+		return i == edges.end() || i == edges.begin() ? -1 : *--i;
+	}
 
-	d0 = pa.dot(a0 - b0);
-	if (fabs(d0) < precision) return false;
-	d1 = pa.dot(a1 - b0);
-	if (fabs(d1) < precision) return false;
-	if ((d0 > 0.0) == (d1 > 0.0)) return false;
+	int next(int e) const {
+		Iterator i = iterators[e];
+		return i == edges.end() || ++i == edges.end() ? -1 : *i;
+	}
+};
 
+bool segments_intersects(const Vector &a0, const Vector &a1, const Vector &b0, const Vector &b1) {
+	Real d0 = cross(a1 - a0, b0 - a0);
+	Real d1 = cross(a1 - a0, b1 - a0);
+	Real d2 = cross(b1 - b0, a0 - b0);
+	Real d3 = cross(b1 - b0, a1 - b0);
+	if ((d0 > 0.0 && d1 > 0.0) || (d0 < 0.0 && d1 < 0.0)) return false;
+	if ((d2 > 0.0 && d3 > 0.0) || (d2 < 0.0 && d3 < 0.0)) return false;
+	if (d0 == 0.0 && d1 == 0.0) {
+		// collinear, check projections
+		return intersects(a0.x, a1.x, b0.x, b1.x)
+		    && intersects(a0.y, a1.y, b0.y, b1.y);
+	}
 	return true;
 }
 
-void Triangulator::build_path(const Contour &contour, Path &path, int index_offset) {
-	// TODO: connect multiple contours
-	path.clear();
-	path.resize(contour.get_chunks().size());
-	for(int i = 0; i < (int)contour.get_chunks().size(); ++i) {
-		const Contour::Chunk &c = contour.get_chunks()[i];
-		Vertex &v = path[i];
-		v.index = i + index_offset;
-		v.p = c.p1;
-		v.next = &v + 1;
-	}
-	path.back().next = &path.front();
+bool edges_intersects(const VertexList &vertices, int a, int b) {
+	if (a < 0 || b < 0 || a == b) return false;
+	int a0 = a, a1 = vertices[a].next;
+	int b0 = b, b1 = vertices[b].next;
+	if (a1 == b0 && b1 == a0) return true;
+
+	// neighbour edges intersects only when overlaps
+	int shared = -1, ao = -1, bo = -1;
+	if (a1 == b0) { shared = a1; ao = a0; bo = b1; } else
+	if (b1 == a0) { shared = a0; ao = a1; bo = b0; }
+	if (shared >= 0) {
+		Vector da = vertices[ao].p - vertices[shared].p;
+		Vector db = vertices[bo].p - vertices[shared].p;
+		return cross(da, db) == 0.0 && da.dot(db) > 0.0;
+	}
+
+	return segments_intersects(vertices[a0].p, vertices[a1].p, vertices[b0].p, vertices[b1].p);
 }
 
-bool Triangulator::check_triangle(Vertex *first, TriangleList &triangles) {
-	// path is a dot
-	if (first->next == first)
-		return true;
+void add_triangle(Triangulator::TriangleList &triangles, const Vector &a, const Vector &b, const Vector &c) {
+	// skip degenerate triangles and keep counter-clockwise order
+	Real area = cross(b - a, c - a);
+	if (area == 0.0) return;
+	triangles.push_back(a);
+	if (area < 0.0)
+		{ triangles.push_back(c); triangles.push_back(b); }
+	else
+		{ triangles.push_back(b); triangles.push_back(c); }
+}
 
-	// path is a two lines
-	if (first->next->next == first)
-		return true;
+// triangulate y-monotone polygon, vertices are in counter-clockwise order
+void triangulate_monotone(const VertexList &vertices, const vector<int> &loop, Triangulator::TriangleList &triangles) {
+	int count = (int)loop.size();
+	if (count < 3) return;
+	if (count == 3) {
+		add_triangle(triangles, vertices[loop[0]].p, vertices[loop[1]].p, vertices[loop[2]].p);
+		return;
+	}
 
-	// path is triangle
-	if (first->next->next->next == first) {
-		triangles.push_back(first->index);
-		triangles.push_back(first->next->index);
-		triangles.push_back(first->next->next->index);
-		return true;
+	int top = 0, bottom = 0;
+	for(int i = 1; i < count; ++i) {
+		if (above(vertices[loop[i]].p, vertices[loop[top]].p)) top = i;
+		if (above(vertices[loop[bottom]].p, vertices[loop[i]].p)) bottom = i;
 	}
 
-	return false;
+	// merge chains, from top in counter-clockwise order goes the left chain
+	vector< pair<int, bool> > sorted;
+	sorted.reserve(count);
+	sorted.push_back(make_pair(loop[top], true));
+	int l = (top + 1)%count, r = (top + count - 1)%count;
+	while(l != bottom || r != bottom) {
+		if (r == bottom || (l != bottom && above(vertices[loop[l]].p, vertices[loop[r]].p)))
+			{ sorted.push_back(make_pair(loop[l], true)); l = (l + 1)%count; }
+		else
+			{ sorted.push_back(make_pair(loop[r], false)); r = (r + count - 1)%count; }
+	}
+	sorted.push_back(make_pair(loop[bottom], true));
+
+	vector< pair<int, bool> > stack;
+	stack.reserve(count);
+	stack.push_back(sorted[0]);
+	stack.push_back(sorted[1]);
+	for(int j = 2; j < count - 1; ++j) {
+		const pair<int, bool> &u = sorted[j];
+		const Vector &p = vertices[u.first].p;
+		if (u.second != stack.back().second) {
+			for(int k = 1; k < (int)stack.size(); ++k)
+				add_triangle(triangles, p, vertices[stack[k-1].first].p, vertices[stack[k].first].p);
+			stack.clear();
+			stack.push_back(sorted[j-1]);
+			stack.push_back(u);
+		} else {
+			pair<int, bool> last = stack.back();
+			stack.pop_back();
+			while(!stack.empty()) {
+				const Vector &a = vertices[stack.back().first].p;
+				const Vector &b = vertices[last.first].p;
+				// diagonal is inside when chain is convex here
+				Real c = u.second ? cross(b - a, p - b) : cross(b - p, a - b);
+				if (c <= 0.0) break;
+				add_triangle(triangles, a, b, p);
+				last = stack.back();
+				stack.pop_back();
+			}
+			stack.push_back(last);
+			stack.push_back(u);
+		}
+	}
+
+	const Vector &p = vertices[sorted.back().first].p;
+	for(int k = 1; k < (int)stack.size(); ++k)
+		add_triangle(triangles, p, vertices[stack[k-1].first].p, vertices[stack[k].first].p);
 }
 
-void Triangulator::split_path(Vertex *first, TriangleList &triangles) {
-	if (check_triangle(first, triangles))
-		return;
+void add_polygon(VertexList &vertices, int first, int polygon) {
+	// remove duplicates and collinear vertices
+	int count = (int)vertices.size() - first;
+	for(int i = first; i < (int)vertices.size(); ++i) {
+		vertices[i].prev = i == first ? (int)vertices.size() - 1 : i - 1;
+		vertices[i].next = i + 1 == (int)vertices.size() ? first : i + 1;
+		vertices[i].polygon = polygon;
+	}
 
-	// split path
-	Vertex *va0 = first;
-	for(Vertex *va1 = va0->next; va1 != first; va1 = va1->next) {
-		if (va0 != va1 && va0->next != va1 && va1->next != va0) {
-			bool intersects = false;
-			for(Vertex *vb0 = first->next; vb0->next != first; vb0 = vb0->next) {
-				Vertex *vb1 = vb0->next;
-				if ( va0 != vb0 && va0 != vb1 && va1 != vb0 && va1 != vb1
-				  && intersect_lines(va0->p, va1->p, vb0->p, vb1->p) )
-					{ intersects = true; break; }
-			}
-			if (!intersects) {
-				Vertex *next = va1->next;
-				va1->next = va0;
-				if (!check_triangle(va0, triangles))
-					split_path(va0, triangles);
-				va1->next = next;
-				va0->next = va1;
-				if (check_triangle(va0, triangles))
-					return;
-				va1 = va0;
-			}
+	int current = first;
+	int checked = 0;
+	while(count >= 3 && checked < count) {
+		Vertex &v = vertices[current];
+		const Vector &p0 = vertices[v.prev].p, &p1 = vertices[v.next].p;
+		if ((v.p.x == p1.x && v.p.y == p1.y) || cross(v.p - p0, p1 - v.p) == 0.0) {
+			vertices[v.prev].next = v.next;
+			vertices[v.next].prev = v.prev;
+			v.polygon = -1;
+			current = v.prev;
+			--count;
+			checked = 0;
+		} else {
+			current = v.next;
+			++checked;
 		}
 	}
 
-	cout << "bug - path not fully triangulated" << endl;
+	if (count < 3)
+		for(int i = first; i < (int)vertices.size(); ++i)
+			vertices[i].polygon = -1;
 }
 
-void Triangulator::triangulate(const Contour &contour, TriangleList &triangles, int index_offset) {
-	Path path;
-	build_path(contour, path, index_offset);
-	triangles.reserve(triangles.size() + 3*(path.size() - 2));
-	split_path(&path.front(), triangles);
 }
 
+
+bool Triangulator::triangulate(const Contour &contour, bool evenodd, TriangleList &triangles) {
+	// build polygons
+
+	VertexList vertices;
+	vertices.reserve(contour.get_chunks().size() + 1);
+	int polygons_count = 0;
+	int first = 0;
+	Vertex v;
+	vertices.push_back(v);
+	for(Contour::ChunkList::const_iterator i = contour.get_chunks().begin(); i != contour.get_chunks().end(); ++i) {
+		if (i->type == Contour::MOVE || i->type == Contour::CLOSE) {
+			if (i->type == Contour::CLOSE) {
+				v.p = i->p1;
+				vertices.push_back(v);
+			}
+			add_polygon(vertices, first, polygons_count++);
+			first = (int)vertices.size();
+		}
+		v.p = i->p1;
+		vertices.push_back(v);
+	}
+	add_polygon(vertices, first, polygons_count++);
+
+	vector<int> sorted;
+	sorted.reserve(vertices.size());
+	for(int i = 0; i < (int)vertices.size(); ++i)
+		if (vertices[i].polygon >= 0)
+			sorted.push_back(i);
+	sort(sorted.begin(), sorted.end(), AboveLess(vertices));
+	for(int i = 1; i < (int)sorted.size(); ++i)
+		if (!above(vertices[sorted[i-1]].p, vertices[sorted[i]].p))
+			return false; // polygons touches
+
+	// first sweep: check intersections (Shamos-Hoey), calculate winding numbers
+	// and choose polygons at boundary of filled area
+
+	vector<int> windings(vertices.size());
+	vector<int> states(polygons_count); // 0 - unknown, 1 - skip, 2 - keep, 3 - reverse
+	{
+		EdgeSet edges(vertices);
+		for(vector<int>::const_iterator i = sorted.begin(); i != sorted.end(); ++i) {
+			int in = vertices[*i].prev, out = *i;
+			const Vector &p = vertices[*i].p;
+			bool in_below = above(p, vertices[in].p);
+			bool out_below = above(p, vertices[vertices[out].next].p);
+
+			if (!in_below && out_below) {
+				windings[out] = windings[in];
+				edges.erase(in);
+				edges.insert(out);
+				if ( edges_intersects(vertices, edges.prev(out), out)
+				  || edges_intersects(vertices, out, edges.next(out)) ) return false;
+			} else
+			if (in_below && !out_below) {
+				windings[in] = windings[out];
+				edges.erase(out);
+				edges.insert(in);
+				if ( edges_intersects(vertices, edges.prev(in), in)
+				  || edges_intersects(vertices, in, edges.next(in)) ) return false;
+			} else
+			if (!in_below && !out_below) {
+				int a = edges.less(in, out) ? in : out;
+				int b = a == in ? out : in;
+				int prev = edges.prev(a), next = edges.next(b);
+				edges.erase(in);
+				edges.erase(out);
+				if (edges_intersects(vertices, prev, next)) return false;
+			} else {
+				int left = edges.left_of(p);
+				int w = left < 0 ? 0 : windings[left];
+				edges.insert(in);
+				edges.insert(out);
+				int a = edges.less(in, out) ? in : out;
+				int b = a == in ? out : in;
+				// edge "in" goes upward
+				windings[a] = w + (a == in ? -1 : 1);
+				windings[b] = w;
+				if ( edges_intersects(vertices, edges.prev(a), a)
+				  || edges_intersects(vertices, a, edges.next(a))
+				  || edges_intersects(vertices, edges.prev(b), b)
+				  || edges_intersects(vertices, b, edges.next(b)) ) return false;
+
+				int &state = states[vertices[*i].polygon];
+				if (!state) {
+					bool filled_outside = evenodd ? (w & 1) : w != 0;
+					bool filled_inside = evenodd ? (windings[a] & 1) : windings[a] != 0;
+					// filled area should be at the left side of edges,
+					// so at the top vertex path should go down by the left edge
+					state = filled_outside == filled_inside ? 1
+					      : (a == out) == filled_inside ? 2 : 3;
+				}
+			}
+		}
+	}
+
+	// reverse polygons if need and remove polygons which not bounds filled area
+
+	for(vector<int>::iterator i = sorted.begin(); i != sorted.end(); ++i) {
+		int state = states[vertices[*i].polygon];
+		if (state == 3)
+			swap(vertices[*i].prev, vertices[*i].next);
+		if (state == 1)
+			*i = -1;
+	}
+	sorted.erase(remove(sorted.begin(), sorted.end(), -1), sorted.end());
+	if (sorted.empty()) return true;
+
+	// second sweep: split to monotone polygons by diagonals
+
+	vector< pair<int, int> > diagonals;
+	{
+		enum { START, SPLIT, END, MERGE, REGULAR };
+		vector<int> types(vertices.size());
+		vector<int> helpers(vertices.size(), -1);
+		EdgeSet edges(vertices);
+		for(vector<int>::const_iterator i = sorted.begin(); i != sorted.end(); ++i) {
+			const Vertex &v = vertices[*i];
+			const Vector &p0 = vertices[v.prev].p, &p1 = vertices[v.next].p;
+			bool prev_below = above(v.p, p0);
+			bool next_below = above(v.p, p1);
+			bool convex = cross(v.p - p0, p1 - v.p) > 0.0;
+			int type = prev_below == next_below
+					 ? (prev_below ? (convex ? START : SPLIT) : (convex ? END : MERGE))
+					 : REGULAR;
+			types[*i] = type;
+
+			int e = *i, prev_e = v.prev;
+			if (type == START) {
+				edges.insert(e);
+				helpers[e] = *i;
+			} else
+			if (type == END) {
+				if (helpers[prev_e] >= 0 && types[helpers[prev_e]] == MERGE)
+					diagonals.push_back(make_pair(*i, helpers[prev_e]));
+				edges.erase(prev_e);
+			} else
+			if (type == SPLIT) {
+				int left = edges.left_of(v.p);
+				if (left < 0) return false;
+				diagonals.push_back(make_pair(*i, helpers[left]));
+				helpers[left] = *i;
+				edges.insert(e);
+				helpers[e] = *i;
+			} else
+			if (type == MERGE) {
+				if (helpers[prev_e] >= 0 && types[helpers[prev_e]] == MERGE)
+					diagonals.push_back(make_pair(*i, helpers[prev_e]));
+				edges.erase(prev_e);
+				int left = edges.left_of(v.p);
+				if (left < 0) return false;
+				if (types[helpers[left]] == MERGE)
+					diagonals.push_back(make_pair(*i, helpers[left]));
+				helpers[left] = *i;
+			} else
+			if (!prev_below) {
+				// left chain, filled area at the right side
+				if (helpers[prev_e] >= 0 && types[helpers[prev_e]] == MERGE)
+					diagonals.push_back(make_pair(*i, helpers[prev_e]));
+				edges.erase(prev_e);
+				edges.insert(e);
+				helpers[e] = *i;
+			} else {
+				int left = edges.left_of(v.p);
+				if (left < 0) return false;
+				if (types[helpers[left]] == MERGE)
+					diagonals.push_back(make_pair(*i, helpers[left]));
+				helpers[left] = *i;
+			}
+		}
+	}
+
+	// collect monotone polygons: half-edges of polygons and both directions of diagonals,
+	// next half-edge is the first outgoing half-edge in clockwise order from the incoming one
+
+	vector< pair<int, int> > half_edges;
+	half_edges.reserve(sorted.size() + 2*diagonals.size());
+	for(vector<int>::const_iterator i = sorted.begin(); i != sorted.end(); ++i)
+		half_edges.push_back(make_pair(*i, vertices[*i].next));
+	for(vector< pair<int, int> >::const_iterator i = diagonals.begin(); i != diagonals.end(); ++i) {
+		half_edges.push_back(*i);
+		half_edges.push_back(make_pair(i->second, i->first));
+	}
+
+	vector<int> outgoing_first(vertices.size() + 1);
+	for(vector< pair<int, int> >::const_iterator i = half_edges.begin(); i != half_edges.end(); ++i)
+		++outgoing_first[i->first + 1];
+	for(int i = 1; i < (int)outgoing_first.size(); ++i)
+		outgoing_first[i] += outgoing_first[i-1];
+	vector< pair<Real, int> > outgoing(half_edges.size());
+	{
+		vector<int> fill(outgoing_first.begin(), outgoing_first.end() - 1);
+		for(int i = 0; i < (int)half_edges.size(); ++i) {
+			Vector d = vertices[half_edges[i].second].p - vertices[half_edges[i].first].p;
+			outgoing[fill[half_edges[i].first]++] = make_pair(atan2(d.y, d.x), i);
+		}
+	}
+	for(vector<int>::const_iterator i = sorted.begin(); i != sorted.end(); ++i)
+		if (outgoing_first[*i + 1] - outgoing_first[*i] > 1)
+			sort(outgoing.begin() + outgoing_first[*i], outgoing.begin() + outgoing_first[*i + 1]);
+
+	vector<int> next_half_edge(half_edges.size());
+	for(int i = 0; i < (int)half_edges.size(); ++i) {
+		int v = half_edges[i].second;
+		vector< pair<Real, int> >::const_iterator b = outgoing.begin() + outgoing_first[v];
+		vector< pair<Real, int> >::const_iterator e = outgoing.begin() + outgoing_first[v + 1];
+		if (e - b == 1) { next_half_edge[i] = b->second; continue; }
+		Vector d = vertices[half_edges[i].first].p - vertices[v].p;
+		vector< pair<Real, int> >::const_iterator j = lower_bound(b, e, make_pair(atan2(d.y, d.x), -1));
+		next_half_edge[i] = (j == b ? e - 1 : j - 1)->second;
+	}
+
+	TriangleList result;
+	result.reserve(3*(sorted.size() + 2*diagonals.size()));
+	vector<bool> visited(half_edges.size());
+	vector<int> loop;
+	for(int i = 0; i < (int)half_edges.size(); ++i) {
+		if (visited[i]) continue;
+		loop.clear();
+		for(int j = i; !visited[j]; j = next_half_edge[j]) {
+			visited[j] = true;
+			loop.push_back(half_edges[j].first);
+			if (loop.size() > half_edges.size()) return false;
+		}
+		triangulate_monotone(vertices, loop, result);
+	}
+
+	triangles.insert(triangles.end(), result.begin(), result.end());
+	return true;
+}
@@ -23,24 +23,20 @@
 #include "geometry.h"
 #include "contour.h"
 
+// Triangulates filled area of contour with any count of sub-contours (holes, islands)
+// for both fill rules. Sub-contours are treated as polygons by end points of chunks,
+// so curves should be split before.
+// Works by sweep line, which calculates winding numbers and splits filled area to
+// y-monotone polygons, then each monotone polygon triangulated in linear time.
+// Total complexity is O(n log n).
 class Triangulator {
 public:
-	class Vertex {
-	public:
-		int index;
-		Vector p;
-		Vertex *next;
-		Vertex(): index(), next() { }
-	};
-
-	typedef std::vector<Vertex> Path;
-	typedef std::vector<int> TriangleList;
-
-	static bool intersect_lines(Vector a0, Vector a1, Vector b0, Vector b1);
-	static void build_path(const Contour &contour, Path &path, int index_offset);
-	static bool check_triangle(Vertex *first, TriangleList &triangles);
-	static void split_path(Vertex *first, TriangleList &triangles);
-	static void triangulate(const Contour &contour, TriangleList &triangles, int index_offset);
+	// three vertices per triangle
+	typedef std::vector<Vector> TriangleList;
+
+	// returns false (and keeps triangles unchanged) when sub-contours
+	// intersects or touches each other or itself, such contours should be drawn by stencil
+	static bool triangulate(const Contour &contour, bool evenodd, TriangleList &triangles);
 };
 
 #endif
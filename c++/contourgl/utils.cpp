@@ -19,6 +19,7 @@
 
 #include "utils.h"
 #include "glcontext.h"
+#include "glreadback.h"
 
 
 using namespace std;
@@ -72,29 +73,9 @@ void Utils::save_rgba(
 }
 
 void Utils::save_viewport(const string &filename) {
-	glFinish();
-
-	GLint  vp[4] = {};
-	glGetIntegerv(GL_VIEWPORT, vp);
-
-	GLint draw_buffer = 0, read_buffer = 0;
-	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_buffer);
-	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_buffer);
-	if (draw_buffer != read_buffer) {
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)read_buffer);
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)draw_buffer);
-		glBlitFramebuffer(vp[0], vp[1], vp[2], vp[3], vp[0], vp[1], vp[2], vp[3], GL_COLOR_BUFFER_BIT, GL_NEAREST);
-		glFinish();
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)draw_buffer);
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)read_buffer);
-	}
-
-	char *buffer = new char[vp[2]*vp[3]*4];
-	glReadPixels(vp[0], vp[1], vp[2], vp[3], GL_BGRA, GL_UNSIGNED_BYTE, buffer);
-
-
-	save_rgba(buffer, vp[2], vp[3], false, filename);
-	delete buffer;
+	// wait for fence of pixel buffer, instead of glFinish
+	GlReadback readback(1);
+	readback.read(filename);
 }
 
 void Utils::save_surface(const Surface &surface, const string &filename) {